@@ -12,8 +12,12 @@ static void PrintHelp()
     std::cout << "\n";
     std::cout << "Options:\n";
     std::cout << "  -t <num_threads>          Number of threads to use  (default: hardware concurrency)\n";
+    std::cout << "  -t <pin[:n]|numa:<nodes>|cpus:<list>>\n";
+    std::cout << "                            Pin threads to processors, grouped by NUMA node (e.g. numa:0,1 or cpus:0-15)\n";
     std::cout << "  -o <output_file>          Output file name  (default: from scene or auto-generated)\n";
     std::cout << "  -s <samples_per_pixel>    Samples per pixel  (default: from scene)\n";
+    std::cout << "  --sampler <independent|stratified|sobol|zsobol|pmj02|bluenoise>\n";
+    std::cout << "                            Sampler type  (default: from scene)\n";
     std::cout << "  -b <max_bounces>          Maximum path bounces  (default: from scene)\n";
     std::cout << "  -i <integrator>           Select integrator by index  (default: from scene)\n";
     std::cout << "  -r <image_scale>          Scale the output image resolution  (default: 1)\n";
@@ -45,7 +49,314 @@ static void PrintOptions()
     std::cout << "  --spatial-samples <count>            Number of spatial neighbors (ReSTIR DI/PT)\n";
     std::cout << "  --m-light <count>                    Number of light candidates (ReSTIR DI)\n";
     std::cout << "  --m-bsdf <count>                     Number of BSDF candidates (ReSTIR DI)\n";
-    std::cout << "  --include-visibility <0|1>           Include visibility in RIS step (ReSTIR DI)\n";
+    std::cout << "  --include-visibility <0|1>           Include visibility in RIS step (ReSTIR DI)\n\n";
+    std::cout << "Acceleration structure options\n";
+    std::cout << "  --accel <bvh|bvh4|bvh8|bvh-q8|bvh-q16>\n";
+    std::cout << "                                       Acceleration structure layout  (default: bvh)\n";
+    std::cout << "  --bvh-builder <sah|sbvh|lbvh|ploc>   BVH construction method        (default: sah)\n";
+    std::cout << "  --split-budget <ratio>               Max duplicated references for spatial splits (default: 0.3)\n";
+    std::cout << "  --bvh-cache <dir>                    Directory of the persistent BVH cache (default: disabled)\n";
+    std::cout << "  --precompute-triangles <0|1>         SIMD leaf intersection of triangles in BVH order (default: 1)\n";
+    std::cout << "  --reorder-nodes <0|1>                Cluster BVH nodes into page sized treelets (default: 0)\n";
+    std::cout << "  --accel-bench <rays_per_pixel>       Measure ray throughput instead of rendering\n\n";
+    std::cout << "Unidirectional integrator options\n";
+    std::cout << "  --pass-spp <count>                   Render the whole frame in passes of this many samples\n";
+    std::cout << "  --time-limit <seconds>               Stop rendering after the given time, the first pass always completes\n";
+    std::cout << "  --snapshot-interval <seconds>        Write the film to <output>_snapshot between passes\n";
+    std::cout << "  --adaptive <threshold>               Spend samples where the relative error is above the threshold\n";
+    std::cout << "  --sort-hits <0|1>                    Shade the camera ray hits of a tile by material (default: 0)\n\n";
+    std::cout << "Threading options\n";
+    std::cout << "  --thread-bench                       Measure the thread pool scaling from 1 to -t threads\n";
+}
+
+// Traces camera rays and one random bounce from each hit, then reports rays per second
+static void BenchmarkAccelerator(const Intersectable* accel, const Camera* camera, int32 rays_per_pixel)
+{
+    const Point2i resolution = camera->GetScreenResolution();
+    const int32 pixel_count = resolution.x * resolution.y;
+
+    std::vector<Ray> secondary_rays(pixel_count);
+    std::vector<uint8> has_secondary(pixel_count);
+
+    double primary_time = 0, secondary_time = 0;
+    std::atomic<int64> primary_count(0), secondary_count(0);
+
+    for (int32 pass = 0; pass < rays_per_pixel; ++pass)
+    {
+        Timer timer;
+
+        ParallelFor(0, resolution.y, [&](int32 y) {
+            RNG rng(Hash(pass, y));
+
+            for (int32 x = 0; x < resolution.x; ++x)
+            {
+                int32 index = y * resolution.x + x;
+
+                PrimaryRay primary_ray;
+                camera->SampleRay(
+                    &primary_ray, { x, y }, { rng.NextFloat(), rng.NextFloat() }, { rng.NextFloat(), rng.NextFloat() }
+                );
+
+                Intersection isect;
+                has_secondary[index] = accel->Intersect(&isect, primary_ray.ray, Ray::epsilon, infinity);
+                if (has_secondary[index])
+                {
+                    Vec3 d = SampleUniformSphere({ rng.NextFloat(), rng.NextFloat() });
+                    secondary_rays[index] = Ray(isect.point, Dot(d, isect.normal) < 0 ? -d : d);
+                }
+            }
+
+            primary_count += resolution.x;
+        });
+
+        primary_time += timer.Mark();
+
+        ParallelFor(0, resolution.y, [&](int32 y) {
+            int32 count = 0;
+            for (int32 x = 0; x < resolution.x; ++x)
+            {
+                int32 index = y * resolution.x + x;
+                if (has_secondary[index])
+                {
+                    Intersection isect;
+                    accel->Intersect(&isect, secondary_rays[index], Ray::epsilon, infinity);
+                    ++count;
+                }
+            }
+
+            secondary_count += count;
+        });
+
+        secondary_time += timer.Mark();
+    }
+
+    std::cout << "Primary rays: " << primary_count / primary_time * 1e-6 << " Mrays/s" << std::endl;
+    std::cout << "Secondary rays: " << secondary_count / secondary_time * 1e-6 << " Mrays/s" << std::endl;
+}
+
+// Reports how close the adaptive sampler got to the error threshold
+static void LogRelativeError(const Film& film, Float threshold)
+{
+    Image1 error = film.GetRelativeErrorImage();
+
+    int32 pixel_count = error.width * error.height;
+    int32 converged = 0;
+    Float max_error = 0;
+    for (int32 i = 0; i < pixel_count; ++i)
+    {
+        converged += error[i] <= threshold;
+        max_error = std::max(max_error, error[i]);
+    }
+
+    std::cout << std::format(
+        "Relative error: {:.2f}% of pixels below {}, max {:.4f}\n", 100.0f * converged / pixel_count, threshold, max_error
+    );
+}
+
+// Like Rendering::WaitAndLogProgress, also writes every new snapshot over the previous one
+static void WaitAndWriteSnapshots(const Rendering* rendering, std::string filename)
+{
+    std::filesystem::path path = filename.size() == 0 ? "bulbit_render.hdr" : filename;
+    std::filesystem::path snapshot_path = path;
+    snapshot_path.replace_filename(path.stem().string() + "_snapshot" + path.extension().string());
+
+    std::shared_ptr<const Image3> last_snapshot;
+    while (!rendering->IsDone())
+    {
+        rendering->LogProgress();
+
+        std::shared_ptr<const Image3> snapshot = rendering->GetSnapshot();
+        if (snapshot && snapshot != last_snapshot)
+        {
+            // Written on this thread, the workers keep rendering meanwhile
+            WriteImage(*snapshot, snapshot_path);
+            last_snapshot = std::move(snapshot);
+        }
+
+        using namespace std::chrono_literals;
+        std::this_thread::sleep_for(50ms);
+    }
+}
+
+// Parses the -t argument, a thread count or a placement of pinned threads:
+//   pin[:n]        n threads spread evenly over the NUMA nodes, one per processor by default
+//   numa:<nodes>   one thread per processor of the listed nodes
+//   cpus:<list>    one thread per listed processor
+static bool ParseThreadSpec(const std::string& spec, int32* num_threads, std::vector<int32>* processors)
+{
+    processors->clear();
+
+    if (!spec.empty() && std::all_of(spec.begin(), spec.end(), [](char c) { return c >= '0' && c <= '9'; }))
+    {
+        *num_threads = std::stoi(spec);
+        return true;
+    }
+
+    std::vector<std::vector<int32>> nodes = GetNumaNodes();
+
+    if (spec == "pin" || spec.starts_with("pin:"))
+    {
+        int32 processor_count = 0;
+        for (const std::vector<int32>& node : nodes)
+        {
+            processor_count += int32(node.size());
+        }
+
+        int32 count = processor_count;
+        if (spec.size() > 4)
+        {
+            std::vector<int32> counts;
+            if (!ParseIndexList(std::string_view(spec).substr(4), &counts) || counts.size() != 1 || counts[0] < 1)
+            {
+                return false;
+            }
+
+            count = std::min(counts[0], processor_count);
+        }
+
+        // Take processors from the nodes in turns, then group them so that neighboring workers share a node
+        std::vector<size_t> taken(nodes.size(), 0);
+        for (int32 i = 0; i < count;)
+        {
+            for (size_t node = 0; node < nodes.size() && i < count; ++node)
+            {
+                if (taken[node] < nodes[node].size())
+                {
+                    ++taken[node];
+                    ++i;
+                }
+            }
+        }
+
+        for (size_t node = 0; node < nodes.size(); ++node)
+        {
+            processors->insert(processors->end(), nodes[node].begin(), nodes[node].begin() + taken[node]);
+        }
+    }
+    else if (spec.starts_with("numa:"))
+    {
+        std::vector<int32> node_indices;
+        if (!ParseIndexList(std::string_view(spec).substr(5), &node_indices))
+        {
+            return false;
+        }
+
+        for (int32 node : node_indices)
+        {
+            if (node >= int32(nodes.size()))
+            {
+                std::cerr << "NUMA node " << node << " not available, found " << nodes.size() << '\n';
+                return false;
+            }
+
+            processors->insert(processors->end(), nodes[node].begin(), nodes[node].end());
+        }
+    }
+    else if (spec.starts_with("cpus:"))
+    {
+        if (!ParseIndexList(std::string_view(spec).substr(5), processors))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    *num_threads = int32(processors->size());
+    return true;
+}
+
+// Runs fine grained, coarse and nested parallel loops with 1 to max_threads threads
+static void BenchmarkThreadScaling(int32 max_threads)
+{
+    std::vector<int32> thread_counts;
+    for (int32 count = 1; count < max_threads; count *= 2)
+    {
+        thread_counts.push_back(count);
+    }
+    thread_counts.push_back(std::max(max_threads, 1));
+
+    std::vector<float> data(1 << 16);
+
+    auto fine = [&](ThreadPool* thread_pool) {
+        // Like film clears and image conversions
+        for (int32 pass = 0; pass < 2000; ++pass)
+        {
+            ParallelFor(0, int32(data.size()), [&](int32 i) { data[i] = data[i] * 0.5f + 1; }, thread_pool);
+        }
+    };
+
+    auto coarse = [&](ThreadPool* thread_pool) {
+        std::atomic<uint64> sum(0);
+        ParallelFor(
+            0, 1024,
+            [&](int32 i) {
+                RNG rng(Hash(i));
+                uint64 local = 0;
+                for (int32 j = 0; j < 100000; ++j)
+                {
+                    local += uint64(rng.NextFloat() * 100);
+                }
+                sum += local;
+            },
+            thread_pool
+        );
+    };
+
+    auto nested = [&](ThreadPool* thread_pool) {
+        // Outer loop over rows, inner loop over the pixels of a row
+        constexpr int32 row_count = 256;
+        const int32 row_size = int32(data.size()) / row_count;
+        for (int32 pass = 0; pass < 200; ++pass)
+        {
+            ParallelFor(
+                0, row_count,
+                [&](int32 y) {
+                    ParallelFor(
+                        0, row_size, [&](int32 x) { data[y * row_size + x] = std::sqrt(data[y * row_size + x] + 1); },
+                        thread_pool
+                    );
+                },
+                thread_pool
+            );
+        }
+    };
+
+    std::cout << std::format("{:>8} {:>16} {:>16} {:>16}", "Threads", "Fine", "Coarse", "Nested") << std::endl;
+
+    double base[3] = { 0, 0, 0 };
+    for (int32 count : thread_counts)
+    {
+        // A single thread runs the loops without a pool
+        std::unique_ptr<ThreadPool> thread_pool;
+        if (count > 1)
+        {
+            thread_pool = std::make_unique<ThreadPool>(count);
+        }
+
+        double times[3];
+        Timer timer;
+        fine(thread_pool.get());
+        times[0] = timer.Mark();
+        coarse(thread_pool.get());
+        times[1] = timer.Mark();
+        nested(thread_pool.get());
+        times[2] = timer.Mark();
+
+        if (count == thread_counts.front())
+        {
+            std::copy(times, times + 3, base);
+        }
+
+        std::cout << std::format("{:>8}", count);
+        for (int32 i = 0; i < 3; ++i)
+        {
+            std::cout << std::format(" {:>8.3f}s {:>5.2f}x", times[i], base[i] / times[i]);
+        }
+        std::cout << std::endl;
+    }
 }
 
 int main(int argc, const char* argv[])
@@ -68,6 +379,7 @@ int main(int argc, const char* argv[])
     }
 
     int32 num_threads = std::thread::hardware_concurrency();
+    std::vector<int32> thread_processors;
     std::string output_file = "";
     int32 spp = 0;
     int32 integrator = -1;
@@ -85,6 +397,21 @@ int main(int argc, const char* argv[])
     int32 M_bsdf = -1;
     int32 include_visibility = -1;
 
+    std::optional<SamplerType> sampler_type;
+    std::optional<AcceleratorType> accel_type;
+    std::optional<BVHBuildMethod> build_method;
+    Float split_budget = -1;
+    std::optional<std::string> cache_directory;
+    int32 precompute_triangles = -1;
+    int32 reorder_nodes = -1;
+    int32 bench_rays_per_pixel = -1;
+    bool thread_bench = false;
+    int32 pass_spp = -1;
+    Float time_limit = -1;
+    Float snapshot_interval = -1;
+    Float adaptive_threshold = -1;
+    int32 sort_hits = -1;
+
     std::vector<std::string> inputs;
 
     for (int32 i = 1; i < argc; ++i)
@@ -93,7 +420,12 @@ int main(int argc, const char* argv[])
 
         if (arg == "-t" && i + 1 < argc)
         {
-            num_threads = std::stoi(argv[++i]);
+            std::string spec = argv[++i];
+            if (!ParseThreadSpec(spec, &num_threads, &thread_processors))
+            {
+                std::cerr << "Invalid thread specification: " << spec << '\n';
+                return 1;
+            }
         }
         else if (arg == "-o" && i + 1 < argc)
         {
@@ -151,6 +483,137 @@ int main(int argc, const char* argv[])
         {
             include_visibility = std::stoi(argv[++i]);
         }
+        else if (arg == "--sampler" && i + 1 < argc)
+        {
+            std::string type = argv[++i];
+            if (type == "independent")
+            {
+                sampler_type = SamplerType::independent;
+            }
+            else if (type == "stratified")
+            {
+                sampler_type = SamplerType::stratified;
+            }
+            else if (type == "sobol")
+            {
+                sampler_type = SamplerType::sobol;
+            }
+            else if (type == "zsobol")
+            {
+                sampler_type = SamplerType::z_sobol;
+            }
+            else if (type == "pmj02")
+            {
+                sampler_type = SamplerType::pmj02;
+            }
+            else if (type == "bluenoise")
+            {
+                sampler_type = SamplerType::blue_noise;
+            }
+            else
+            {
+                std::cerr << "Unknown sampler: " << type << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "--accel" && i + 1 < argc)
+        {
+            std::string type = argv[++i];
+            if (type == "bvh")
+            {
+                accel_type = AcceleratorType::bvh;
+            }
+            else if (type == "bvh4")
+            {
+                accel_type = AcceleratorType::bvh4;
+            }
+            else if (type == "bvh8")
+            {
+                accel_type = AcceleratorType::bvh8;
+            }
+            else if (type == "bvh-q8")
+            {
+                accel_type = AcceleratorType::bvh_q8;
+            }
+            else if (type == "bvh-q16")
+            {
+                accel_type = AcceleratorType::bvh_q16;
+            }
+            else
+            {
+                std::cerr << "Unknown acceleration structure: " << type << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "--bvh-builder" && i + 1 < argc)
+        {
+            std::string method = argv[++i];
+            if (method == "sah")
+            {
+                build_method = BVHBuildMethod::sah;
+            }
+            else if (method == "sbvh")
+            {
+                build_method = BVHBuildMethod::sbvh;
+            }
+            else if (method == "lbvh")
+            {
+                build_method = BVHBuildMethod::lbvh;
+            }
+            else if (method == "ploc")
+            {
+                build_method = BVHBuildMethod::ploc;
+            }
+            else
+            {
+                std::cerr << "Unknown BVH builder: " << method << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "--split-budget" && i + 1 < argc)
+        {
+            split_budget = std::stof(argv[++i]);
+        }
+        else if (arg == "--bvh-cache" && i + 1 < argc)
+        {
+            cache_directory = argv[++i];
+        }
+        else if (arg == "--precompute-triangles" && i + 1 < argc)
+        {
+            precompute_triangles = std::stoi(argv[++i]);
+        }
+        else if (arg == "--reorder-nodes" && i + 1 < argc)
+        {
+            reorder_nodes = std::stoi(argv[++i]);
+        }
+        else if (arg == "--accel-bench" && i + 1 < argc)
+        {
+            bench_rays_per_pixel = std::stoi(argv[++i]);
+        }
+        else if (arg == "--pass-spp" && i + 1 < argc)
+        {
+            pass_spp = std::stoi(argv[++i]);
+        }
+        else if (arg == "--time-limit" && i + 1 < argc)
+        {
+            time_limit = std::stof(argv[++i]);
+        }
+        else if (arg == "--snapshot-interval" && i + 1 < argc)
+        {
+            snapshot_interval = std::stof(argv[++i]);
+        }
+        else if (arg == "--adaptive" && i + 1 < argc)
+        {
+            adaptive_threshold = std::stof(argv[++i]);
+        }
+        else if (arg == "--sort-hits" && i + 1 < argc)
+        {
+            sort_hits = std::stoi(argv[++i]);
+        }
+        else if (arg == "--thread-bench")
+        {
+            thread_bench = true;
+        }
         else if (arg == "--list-samples")
         {
             std::cout << "Available built-in samples:\n";
@@ -180,13 +643,19 @@ int main(int argc, const char* argv[])
         }
     }
 
+    if (thread_bench)
+    {
+        BenchmarkThreadScaling(num_threads);
+        return 0;
+    }
+
     if (inputs.size() == 0)
     {
         std::cerr << "Error: No scene file or sample name provided.\n";
         return 1;
     }
 
-    ThreadPool::global_thread_pool.reset(new ThreadPool(num_threads));
+    ThreadPool::global_thread_pool.reset(new ThreadPool(num_threads, thread_processors));
 
     for (const std::string& input : inputs)
     {
@@ -209,6 +678,7 @@ int main(int argc, const char* argv[])
         }
 
         if (spp > 0) ri.camera_info.sampler_info.spp = spp;
+        if (sampler_type) ri.camera_info.sampler_info.type = sampler_type.value();
         if (max_bounces >= 0) ri.integrator_info.max_bounces = max_bounces;
         if (num_photons >= 0) ri.integrator_info.n_photons = num_photons;
         if (sample_direct_light >= 0) ri.integrator_info.sample_direct_light = bool(sample_direct_light);
@@ -220,17 +690,40 @@ int main(int argc, const char* argv[])
         if (M_light >= 0) ri.integrator_info.M_light = M_light;
         if (M_bsdf >= 0) ri.integrator_info.M_bsdf = M_bsdf;
         if (include_visibility >= 0) ri.integrator_info.include_visibility = bool(include_visibility);
+        if (accel_type) ri.accelerator_info.type = accel_type.value();
+        if (build_method) ri.accelerator_info.build_method = build_method.value();
+        if (split_budget >= 0) ri.accelerator_info.split_budget = split_budget;
+        if (cache_directory) ri.accelerator_info.cache_directory = cache_directory.value();
+        if (precompute_triangles >= 0) ri.accelerator_info.precompute_triangles = bool(precompute_triangles);
+        if (reorder_nodes >= 0) ri.accelerator_info.reorder_nodes = bool(reorder_nodes);
+        if (pass_spp >= 0) ri.integrator_info.pass_spp = pass_spp;
+        if (time_limit >= 0) ri.integrator_info.time_limit = time_limit;
+        if (snapshot_interval >= 0) ri.integrator_info.snapshot_interval = snapshot_interval;
+        if (adaptive_threshold >= 0) ri.integrator_info.adaptive_threshold = adaptive_threshold;
+        if (sort_hits >= 0) ri.integrator_info.sort_hits = bool(sort_hits);
         ri.camera_info.film_info.resolution *= scale;
 
         std::cout << "\rLoading scene.. " << timer.Mark() << "s" << std::endl;
-        std::cout << "Primitives: " << ri.scene.GetPrimitives().size() << ", Lights: " << ri.scene.GetLights().size()
-                  << std::endl;
+        std::cout << "Primitives: " << ri.scene.GetPrimitives().size() << ", Instances: " << ri.scene.GetInstances().size()
+                  << ", Lights: " << ri.scene.GetLights().size() << std::endl;
+
+        Allocator alloc;
 
         std::cout << "\rBuilding acceleration structure.. " << std::flush;
-        BVH accel(ri.scene.GetPrimitives());
+        AcceleratorStats accel_stats;
+        Intersectable* accel = CreateAccelerator(alloc, ri.accelerator_info, ri.scene, &accel_stats);
+        if (!accel)
+        {
+            std::cerr << "Failed to create acceleration structure" << std::endl;
+            return 0;
+        }
         std::cout << "\rBuilding acceleration structure.. " << timer.Mark() << "s" << std::endl;
-
-        Allocator alloc;
+        std::cout << "Nodes: " << accel_stats.node_count << ", SAH cost: " << accel_stats.sah_cost
+                  << ", Memory: " << accel_stats.memory_usage / (1024.0 * 1024.0) << "MB" << std::endl;
+        if (!ri.accelerator_info.cache_directory.empty())
+        {
+            std::cout << "BVH cache hits: " << accel_stats.cache_hits << ", misses: " << accel_stats.cache_misses << std::endl;
+        }
 
         Filter* filter = Filter::Create(alloc, ri.camera_info.film_info.filter_info);
         if (!filter)
@@ -246,7 +739,17 @@ int main(int argc, const char* argv[])
             return 0;
         }
 
-        Sampler* sampler = Sampler::Create(alloc, ri.camera_info.sampler_info);
+        if (bench_rays_per_pixel > 0)
+        {
+            BenchmarkAccelerator(accel, camera, bench_rays_per_pixel);
+
+            alloc.delete_object(camera);
+            alloc.delete_object(filter);
+            alloc.delete_object(accel);
+            continue;
+        }
+
+        Sampler* sampler = Sampler::Create(alloc, ri.camera_info.sampler_info, ri.camera_info.film_info.resolution);
         if (!sampler)
         {
             std::cerr << "Failed to sampler" << std::endl;
@@ -254,7 +757,7 @@ int main(int argc, const char* argv[])
         }
 
         std::cout << "\rInitializing integrator.. " << std::flush;
-        Integrator* integrator = Integrator::Create(alloc, ri.integrator_info, &accel, ri.scene.GetLights(), sampler);
+        Integrator* integrator = Integrator::Create(alloc, ri.integrator_info, accel, ri.scene.GetLights(), sampler);
         if (!integrator)
         {
             std::cerr << "Failed to create integrator" << std::endl;
@@ -263,11 +766,23 @@ int main(int argc, const char* argv[])
 
         std::cout << "\rInitializing integrator.. " << timer.Mark() << "s" << std::endl;
         Rendering* rendering = integrator->Render(alloc, camera);
-        rendering->WaitAndLogProgress();
+        if (ri.integrator_info.snapshot_interval > 0)
+        {
+            WaitAndWriteSnapshots(rendering, output_file.size() == 0 ? ri.camera_info.film_info.filename : output_file);
+        }
+        else
+        {
+            rendering->WaitAndLogProgress();
+        }
 
         double render_time = timer.Mark();
         std::cout << "\nComplete " << render_time << 's' << std::endl;
 
+        if (ri.integrator_info.adaptive_threshold > 0)
+        {
+            LogRelativeError(rendering->GetFilm(), ri.integrator_info.adaptive_threshold);
+        }
+
         Image3 image = rendering->GetFilm().GetRenderedImage();
 
         std::string filename = output_file.size() == 0 ? ri.camera_info.film_info.filename : output_file;
@@ -297,6 +812,7 @@ int main(int argc, const char* argv[])
         alloc.delete_object(sampler);
         alloc.delete_object(camera);
         alloc.delete_object(filter);
+        alloc.delete_object(accel);
 
         // system(filename.c_str());
     }
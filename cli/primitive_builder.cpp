@@ -43,6 +43,13 @@ void CreateSphere(
     std::optional<AreaLightInfo> area_light
 )
 {
+    if (area_light && scene.IsDefiningObject())
+    {
+        // Instanced objects live in their own space that area lights can't refer to
+        std::cerr << "Area lights are not supported in instanced objects" << std::endl;
+        area_light.reset();
+    }
+
     Sphere* sphere = scene.CreateShape<Sphere>(tf, radius);
     Primitive* primitive = scene.CreatePrimitive(sphere, material, medium_interface);
 
@@ -75,6 +82,13 @@ void CreateTriangles(
     std::optional<AreaLightInfo> area_light
 )
 {
+    if (area_light && scene.IsDefiningObject())
+    {
+        // Instanced objects live in their own space that area lights can't refer to
+        std::cerr << "Area lights are not supported in instanced objects" << std::endl;
+        area_light.reset();
+    }
+
     for (int32 i = 0; i < mesh->GetTriangleCount(); ++i)
     {
         Triangle* triangle = scene.CreateShape<Triangle>(mesh, i);
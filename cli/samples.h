@@ -67,4 +67,5 @@ inline constexpr std::array<std::string_view, size_t(IntegratorType::count)> int
     "Ambient Occlusion",
     "Albedo",
     "Debug",
+    "Wavefront Path Tracing",
 };
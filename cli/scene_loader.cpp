@@ -19,6 +19,7 @@ namespace bulbit
 using DefaultMap = HashMap<std::string, std::string>;
 using MaterialMap = HashMap<std::string, const Material*>;
 using MediumMap = HashMap<std::string, const Medium*>;
+using ObjectMap = HashMap<std::string, int32>;
 
 static Float VFovToHFov(Float vfov, Float aspect)
 {
@@ -431,6 +432,22 @@ static SamplerInfo ParseSampler(pugi::xml_node node, const DefaultMap& dm)
     {
         sampler.type = SamplerType::stratified;
     }
+    else if (name == "sobol")
+    {
+        sampler.type = SamplerType::sobol;
+    }
+    else if (name == "zsobol")
+    {
+        sampler.type = SamplerType::z_sobol;
+    }
+    else if (name == "pmj02")
+    {
+        sampler.type = SamplerType::pmj02;
+    }
+    else if (name == "bluenoise")
+    {
+        sampler.type = SamplerType::blue_noise;
+    }
     else
     {
         std::cerr << "Sampler not supported: " << name << std::endl;
@@ -538,6 +555,7 @@ static void ParseIntegrator(pugi::xml_node node, DefaultMap& dm, IntegratorInfo&
     else if (type == "vcm") { ri.type = IntegratorType::vcm; }
     else if (type == "restir_di") { ri.type = IntegratorType::restir_di; }
     else if (type == "restir_pt") { ri.type = IntegratorType::restir_pt; }
+    else if (type == "wavefront_path") { ri.type = IntegratorType::wavefront_path; }
     // clang-format on
     else
     {
@@ -1955,6 +1973,58 @@ static void ParseShape(pugi::xml_node node, const DefaultMap& dm, MaterialMap& m
     }
 }
 
+static void ParseShapeGroup(
+    pugi::xml_node node, const DefaultMap& dm, MaterialMap& mm, MediumMap& mdm, ObjectMap& om, Scene* scene
+)
+{
+    std::string id = node.attribute("id").value();
+    if (id.empty())
+    {
+        std::cerr << "Shape group id not specified." << std::endl;
+        return;
+    }
+
+    // Shapes in the group are shared by all instances referring to it
+    int32 object = scene->BeginObject();
+    for (auto child : node.children())
+    {
+        if (std::string(child.name()) == "shape")
+        {
+            ParseShape(child, dm, mm, mdm, scene);
+        }
+    }
+    scene->EndObject();
+
+    om.Insert(id, object);
+}
+
+static void ParseInstance(pugi::xml_node node, const DefaultMap& dm, const ObjectMap& om, Scene* scene)
+{
+    std::string id;
+    Transform to_world = identity;
+
+    for (auto child : node.children())
+    {
+        std::string name = child.name();
+        if (name == "ref")
+        {
+            id = child.attribute("id").value();
+        }
+        else if (name == "transform" && std::string(child.attribute("name").value()) == "to_world")
+        {
+            to_world = ParseTransform(child, dm);
+        }
+    }
+
+    if (!om.Contains(id))
+    {
+        std::cerr << "Shape group reference not found: " << id << std::endl;
+        return;
+    }
+
+    scene->CreateInstance(om.At(id), to_world);
+}
+
 static void ParseLight(pugi::xml_node node, const DefaultMap& dm, Scene* scene)
 {
     std::string type = node.attribute("type").value();
@@ -2106,6 +2176,7 @@ static bool ParseScene(RendererInfo* ri, pugi::xml_node scene_node)
     DefaultMap dm;
     MaterialMap mm;
     MediumMap mdm;
+    ObjectMap om;
 
     for (auto node : scene_node.children())
     {
@@ -2137,7 +2208,19 @@ static bool ParseScene(RendererInfo* ri, pugi::xml_node scene_node)
         }
         else if (name == "shape")
         {
-            ParseShape(node, dm, mm, mdm, &ri->scene);
+            std::string type = node.attribute("type").value();
+            if (type == "shapegroup")
+            {
+                ParseShapeGroup(node, dm, mm, mdm, om, &ri->scene);
+            }
+            else if (type == "instance")
+            {
+                ParseInstance(node, dm, om, &ri->scene);
+            }
+            else
+            {
+                ParseShape(node, dm, mm, mdm, &ri->scene);
+            }
         }
     }
 
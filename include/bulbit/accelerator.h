@@ -0,0 +1,101 @@
+#pragma once
+
+#include "allocator.h"
+#include "instance.h"
+#include "primitive.h"
+
+namespace bulbit
+{
+
+class Scene;
+struct AcceleratorInfo;
+
+struct AcceleratorStats
+{
+    int32 node_count = 0;
+    Float sah_cost = 0;
+    size_t memory_usage = 0; // In bytes, including the primitive references
+
+    // Persistent BVH cache lookups, counted per built structure
+    int32 cache_hits = 0;
+    int32 cache_misses = 0;
+};
+
+Intersectable* CreateAccelerator(
+    Allocator& alloc,
+    const AcceleratorInfo& accel_info,
+    const std::vector<Intersectable*>& primitives,
+    AcceleratorStats* stats = nullptr
+);
+Intersectable* CreateAccelerator(
+    Allocator& alloc,
+    const AcceleratorInfo& accel_info,
+    const std::vector<Primitive*>& primitives,
+    AcceleratorStats* stats = nullptr
+);
+
+// Creates a two-level acceleration structure if the scene has instances
+Intersectable* CreateAccelerator(
+    Allocator& alloc, const AcceleratorInfo& accel_info, const Scene& scene, AcceleratorStats* stats = nullptr
+);
+
+// Top level acceleration structure over the scene primitives and object instances
+// Bottom level structures of the objects are shared between their instances
+class TwoLevelAccelerator : public Intersectable
+{
+public:
+    TwoLevelAccelerator(Allocator& alloc, const AcceleratorInfo& accel_info, const Scene& scene, AcceleratorStats* stats);
+    ~TwoLevelAccelerator();
+
+    virtual AABB GetAABB() const override;
+    virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+
+    virtual void IntersectN(
+        std::span<Intersection> out_isects, std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, Float t_max
+    ) const override;
+    virtual void IntersectAnyN(
+        std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max
+    ) const override;
+
+private:
+    Allocator alloc;
+
+    std::vector<Intersectable*> objects;
+    std::vector<Instance> instances;
+
+    // Kept alive for top level structures that reference their primitive list
+    std::vector<Intersectable*> top_level_primitives;
+    Intersectable* top_level;
+};
+
+inline AABB TwoLevelAccelerator::GetAABB() const
+{
+    return top_level->GetAABB();
+}
+
+inline bool TwoLevelAccelerator::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    return top_level->Intersect(isect, ray, t_min, t_max);
+}
+
+inline bool TwoLevelAccelerator::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    return top_level->IntersectAny(ray, t_min, t_max);
+}
+
+inline void TwoLevelAccelerator::IntersectN(
+    std::span<Intersection> isects, std::span<bool> hits, std::span<const Ray> rays, Float t_min, Float t_max
+) const
+{
+    top_level->IntersectN(isects, hits, rays, t_min, t_max);
+}
+
+inline void TwoLevelAccelerator::IntersectAnyN(
+    std::span<bool> hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max
+) const
+{
+    top_level->IntersectAnyN(hits, rays, t_min, t_max);
+}
+
+} // namespace bulbit
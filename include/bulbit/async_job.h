@@ -14,21 +14,9 @@ public:
     {
     }
 
-    virtual bool HaveWork() const override
+    virtual void Run() override
     {
-        return !started;
-    }
-
-    virtual void RunStep(std::unique_lock<std::mutex>* lock) override
-    {
-        thread_pool->RemoveJob(this);
-        started = true;
-        lock->unlock();
-
-        T res = func();
-        std::unique_lock<std::mutex> l(mutex);
-        result = res;
-        cv.notify_all();
+        DoWork();
     }
 
     bool IsReady() const
@@ -46,9 +34,9 @@ public:
 
     void Wait()
     {
-        while (!IsReady())
+        while (!IsReady() && thread_pool)
         {
-            if (thread_pool->WorkOrReturn() == false)
+            if (thread_pool->RunPendingJob() == false)
             {
                 // Other thread is running this job
                 break;
@@ -77,8 +65,6 @@ private:
 
     mutable std::mutex mutex;
     std::condition_variable cv;
-
-    bool started = false;
 };
 
 template <typename F, typename... Args>
@@ -88,15 +74,10 @@ inline auto RunAsync(ThreadPool* thread_pool, F&& func, Args&&... args)
     using R = std::invoke_result_t<decltype(fvoid)>;
     auto job = std::make_unique<AsyncJob<R>>(std::move(fvoid));
 
-    std::unique_lock<std::mutex> lock;
-    if (!thread_pool)
+    if (!thread_pool || !thread_pool->Submit(job.get()))
     {
         job->DoWork();
     }
-    else
-    {
-        lock = thread_pool->AddJob(job.get());
-    }
 
     return job;
 }
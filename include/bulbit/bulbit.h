@@ -11,10 +11,15 @@
 #include "scene.h"
 #include "shapes.h"
 
+#include "accelerator.h"
 #include "bvh.h"
+#include "compressed_bvh.h"
 #include "dynamic_bvh.h"
+#include "instance.h"
+#include "wide_bvh.h"
 
 #include "async_job.h"
+#include "mapped_file.h"
 #include "parallel_for.h"
 #include "progress.h"
 #include "timer.h"
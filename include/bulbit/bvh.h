@@ -1,27 +1,87 @@
 #pragma once
 
 #include "growable_array.h"
+#include "mapped_file.h"
 #include "medium.h"
 #include "parallel.h"
 #include "primitive.h"
+#include "simd.h"
 
 namespace bulbit
 {
 
+class Triangle;
+
+enum class BVHBuildMethod
+{
+    sah,
+    sbvh,
+    lbvh,
+    ploc,
+};
+
 class BVH : public Intersectable
 {
 public:
     BVH() = default;
-    BVH(const std::vector<Primitive*>& primitives);
+
+    // split_budget: maximum number of duplicated references created by spatial splits, relative to the primitive count
+    BVH(
+        const std::vector<Intersectable*>& primitives,
+        BVHBuildMethod build_method = BVHBuildMethod::sah,
+        Float split_budget = 0.3f
+    );
+    BVH(const std::vector<Primitive*>& primitives, BVHBuildMethod build_method = BVHBuildMethod::sah, Float split_budget = 0.3f);
     ~BVH();
 
     virtual AABB GetAABB() const override;
     virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
     virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
 
+    virtual void IntersectN(
+        std::span<Intersection> out_isects, std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, Float t_max
+    ) const override;
+    virtual void IntersectAnyN(
+        std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max
+    ) const override;
+
+    // Expected cost of a random ray query relative to a single primitive intersection
+    Float GetSAHCost() const;
+    int32 GetNodeCount() const;
+    size_t GetMemoryUsage() const;
+
+    // Clusters the sibling pairs into page sized treelets, most likely visited pairs first
+    // Keeps the tree intact, only the node order changes
+    void ReorderNodes();
+
+    // Updates the node bounds bottom-up after the primitives moved, e.g. after Mesh::SetPositions
+    // Subtrees whose SAH cost grew past rebuild_threshold times their cost at build time are rebuilt
+    // Returns the number of rebuilt subtrees
+    int32 Refit(Float rebuild_threshold = 1.5f);
+
+    // Copies the triangles of the leaves into a contiguous SoA array in reference order, leaves then test 4/8 triangles at once
+    // Triangles with alpha textures and other shapes keep going through Intersectable
+    void PrecomputeTriangles();
+
+    // Persistent cache
+    // The key identifies the geometry and build settings, the primitives must be given in the order used for the build
+    static uint64 GetCacheKey(
+        const std::vector<Intersectable*>& primitives, BVHBuildMethod build_method, Float split_budget, bool reorder_nodes
+    );
+
+    // Memory maps the nodes of a cache file, returns false if the file is missing or stale
+    bool Load(const std::filesystem::path& filename, const std::vector<Intersectable*>& primitives, uint64 key);
+    bool Save(const std::filesystem::path& filename, const std::vector<Intersectable*>& primitives, uint64 key) const;
+
 private:
     friend class Scene;
 
+    template <int32 N>
+    friend class WideBVH;
+
+    template <typename T>
+    friend class CompressedBVH;
+
     struct BVHPrimitive
     {
         BVHPrimitive() = default;
@@ -43,6 +103,8 @@ private:
         BuildNode* child2;
     };
 
+    // Children of an internal node are stored next to each other, child_offset is the first of them
+    // Node 0 is placed in the second half of a cache line so that every sibling pair shares a line
     struct alignas(32) LinearBVHNode
     {
         AABB aabb;
@@ -50,30 +112,143 @@ private:
         union
         {
             int32 primitives_offset;
-            int32 child2_offset;
+            int32 child_offset;
         };
 
         uint16 primitive_count;
         uint8 axis;
     };
 
+    static LinearBVHNode* AllocateNodes(int32 count);
+    static void FreeNodes(LinearBVHNode* nodes);
+
     BuildNode* BuildRecursive(
         ThreadLocal<Allocator>& thread_allocators,
         std::span<BVHPrimitive> primitive_span,
         std::atomic<int32>* total_nodes,
         std::atomic<int32>* ordered_prims_offset,
-        std::vector<Primitive*>& ordered_prims
+        std::vector<Intersectable*>& ordered_prims
+    );
+
+    BuildNode* BuildSpatialRecursive(
+        ThreadLocal<Allocator>& thread_allocators,
+        std::vector<BVHPrimitive>& references,
+        Float min_overlap_area,
+        std::atomic<int32>* split_budget,
+        std::atomic<int32>* total_nodes,
+        std::atomic<int32>* ordered_prims_offset,
+        std::vector<Intersectable*>& ordered_prims
+    );
+
+    BuildNode* BuildLinear(
+        ThreadLocal<Allocator>& thread_allocators,
+        std::span<BVHPrimitive> primitive_span,
+        BVHBuildMethod build_method,
+        std::atomic<int32>* total_nodes,
+        std::atomic<int32>* ordered_prims_offset,
+        std::vector<Intersectable*>& ordered_prims
     );
 
-    int32 FlattenBVH(BuildNode* node, int32* offset);
+    int32 AssignLeafPrimitives(
+        BuildNode* node, std::atomic<int32>* ordered_prims_offset, std::vector<Intersectable*>& ordered_prims
+    );
+
+    void FlattenBVH(BuildNode* node, int32 index, int32* offset);
+
+    void SetupRefit();
+    AABB RefitRecursive(int32 index);
+    Float GetSubtreeSAHCost(int32 index) const;
+    Float GetTotalSAHCost(const std::vector<Float>& subtree_costs) const;
+
+    // Rebuilds the subtrees under the given nodes with SAH
+    void RebuildSubtrees(const std::vector<int32>& roots);
+
+    // Copies the new vertex positions into the precomputed triangles without changing the layout
+    void UpdateTriangles();
+    void SetTriangle(int32 index, const Triangle* triangle);
+
+    // Precomputed triangles in reference order, padded so that a full SIMD width can be loaded at any offset
+    struct TriangleData
+    {
+        static constexpr int32 padding = 8;
+
+        // Ray set up for the watertight test (Woop et al. 2013), the dominant direction axis becomes z
+        // and the shear maps the direction onto it
+        struct ShearedRay
+        {
+            ShearedRay(const Ray& ray);
+
+            Point3 o;
+            int32 kx, ky, kz;
+            Float sx, sy, sz;
+        };
+
+        bool IsEmpty() const;
+
+        // Closest hit among the references [offset, offset + count), returns the reference index or -1
+        int32 Intersect(
+            const ShearedRay& ray, Float t_min, Float t_max, int32 offset, int32 count, Float* t, Float* u, Float* v
+        ) const;
+
+        size_t GetMemoryUsage() const;
+
+        // Vertices as stored in the mesh, edges computed from them would not be shared exactly by neighboring triangles
+        std::vector<Float> p0[3], p1[3], p2[3];
+
+        // Zero for the references not stored here, their data is zeroed so that they never report hits
+        std::vector<uint8> precomputed;
+        bool all_precomputed;
+    };
 
     template <typename T>
     void RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const;
 
-    std::vector<Primitive*> primitives;
-    LinearBVHNode* nodes;
+    // Up to 64 rays in SoA layout, traversed together with a bit mask of the active rays
+    struct RayPacket
+    {
+        static constexpr int32 max_size = 64;
+
+        RayPacket(std::span<const Ray> rays, Float t_min, Float t_max);
+
+        uint64 TestAABB(const AABB& aabb, uint64 active_mask) const;
+
+        int32 size;
+        Float t_min;
+
+        alignas(32) Float o[3][max_size];
+        alignas(32) Float inv_dir[3][max_size];
+        alignas(32) Float t_max[max_size];
+    };
+
+    template <typename T>
+    void RayCastPacket(RayPacket* packet, std::span<const Ray> rays, T* callback) const;
+
+    std::vector<Intersectable*> primitives;
+    LinearBVHNode* nodes = nullptr;
+    int32 node_count = 0;
+
+    // Owns the nodes if the BVH was loaded from a cache file
+    std::unique_ptr<MappedFile> mapped_file;
+
+    TriangleData triangles;
+
+    // Node order is restored after rebuilding subtrees
+    bool reordered = false;
+
+    // Roots of the subtrees refitted in parallel, with their SAH cost measured after the last (re)build
+    std::vector<int32> refit_roots;
+    std::vector<Float> refit_costs;
+    Float refit_total_cost;
+
+    // Internal nodes above the subtree roots in DFS order
+    std::vector<int32> refit_top_nodes;
 };
 
+inline BVH::BVH(const std::vector<Primitive*>& primitives, BVHBuildMethod build_method, Float split_budget)
+    : BVH(std::vector<Intersectable*>(primitives.begin(), primitives.end()), build_method, split_budget)
+{
+}
+
 inline BVH::BVHPrimitive::BVHPrimitive(size_t index, const AABB& aabb)
     : index{ index }
     , aabb{ aabb }
@@ -98,11 +273,47 @@ inline void BVH::BuildNode::InitInternal(int32 _axis, BuildNode* _child1, BuildN
     count = 0;
 }
 
+inline BVH::LinearBVHNode* BVH::AllocateNodes(int32 count)
+{
+    std::byte* memory = (std::byte*)::operator new[]((count + 1) * sizeof(LinearBVHNode), std::align_val_t(64));
+
+    LinearBVHNode* nodes = (LinearBVHNode*)memory + 1;
+    std::uninitialized_default_construct_n(nodes, count);
+    return nodes;
+}
+
+inline void BVH::FreeNodes(LinearBVHNode* nodes)
+{
+    if (nodes)
+    {
+        ::operator delete[]((std::byte*)(nodes - 1), std::align_val_t(64));
+    }
+}
+
+inline BVH::TriangleData::ShearedRay::ShearedRay(const Ray& ray)
+    : o{ ray.o }
+{
+    Vec3 d(std::fabs(ray.d.x), std::fabs(ray.d.y), std::fabs(ray.d.z));
+    kz = d.x > d.y ? (d.x > d.z ? 0 : 2) : (d.y > d.z ? 1 : 2);
+    kx = (kz + 1) % 3;
+    ky = (kx + 1) % 3;
+
+    sz = 1 / ray.d[kz];
+    sx = ray.d[kx] * sz;
+    sy = ray.d[ky] * sz;
+}
+
+inline bool BVH::TriangleData::IsEmpty() const
+{
+    return precomputed.empty();
+}
+
 template <typename T>
 inline void BVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const
 {
     const Vec3 inv_dir(1 / r.d.x, 1 / r.d.y, 1 / r.d.z);
     const int32 is_dir_neg[3] = { int32(inv_dir.x < 0), int32(inv_dir.y < 0), int32(inv_dir.z < 0) };
+    const TriangleData::ShearedRay sheared_ray(r);
 
     GrowableArray<int32, 64> stack;
     stack.Emplace(0);
@@ -116,9 +327,17 @@ inline void BVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) co
             if (nodes[index].primitive_count > 0)
             {
                 // Leaf node
-                for (int32 i = 0; i < nodes[index].primitive_count; ++i)
+                int32 offset = nodes[index].primitives_offset;
+                int32 count = nodes[index].primitive_count;
+
+                for (int32 i = 0; i < count; ++i)
                 {
-                    Float t = callback->RayCastCallback(r, t_min, t_max, primitives[nodes[index].primitives_offset + i]);
+                    if (!triangles.IsEmpty() && (triangles.all_precomputed || triangles.precomputed[offset + i]))
+                    {
+                        continue;
+                    }
+
+                    Float t = callback->RayCastCallback(r, t_min, t_max, primitives[offset + i]);
                     if (t <= t_min)
                     {
                         return;
@@ -129,6 +348,24 @@ inline void BVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) co
                         t_max = t;
                     }
                 }
+
+                if (!triangles.IsEmpty())
+                {
+                    Float t_hit, u, v;
+                    int32 hit = triangles.Intersect(sheared_ray, t_min, t_max, offset, count, &t_hit, &u, &v);
+                    if (hit >= 0)
+                    {
+                        Float t = callback->RayCastTriangleCallback(t_min, hit, t_hit, u, v);
+                        if (t <= t_min)
+                        {
+                            return;
+                        }
+                        else
+                        {
+                            t_max = t;
+                        }
+                    }
+                }
             }
             else
             {
@@ -136,8 +373,15 @@ inline void BVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) co
 
                 // Ordered traversal
                 // Put far child on stack first
-                int32 child1 = index + 1;
-                int32 child2 = nodes[index].child2_offset;
+                int32 child1 = nodes[index].child_offset;
+                int32 child2 = child1 + 1;
+
+                // Children of the far child are needed once it is popped
+                const LinearBVHNode& far_child = nodes[is_dir_neg[nodes[index].axis] ? child1 : child2];
+                if (far_child.primitive_count == 0)
+                {
+                    Prefetch(&nodes[far_child.child_offset]);
+                }
 
                 if (is_dir_neg[nodes[index].axis])
                 {
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "bvh.h"
+
+namespace bulbit
+{
+
+// Binary BVH whose child bounds are quantized to 8 or 16 bits relative to the bounds of their parent.
+// Both child boxes are stored in the parent node, so there are half as many nodes as in the full precision BVH.
+// Leaves store 32 bit indices into the primitive list it was built from, that list is not copied and must outlive the BVH.
+template <typename T>
+class CompressedBVH : public Intersectable
+{
+    static_assert(std::is_same_v<T, uint8> || std::is_same_v<T, uint16>, "CompressedBVH supports 8 or 16 bit quantization");
+
+public:
+    CompressedBVH(
+        const std::vector<Intersectable*>& primitives,
+        BVHBuildMethod build_method = BVHBuildMethod::sah,
+        Float split_budget = 0.3f
+    );
+    CompressedBVH(
+        const std::vector<Primitive*>& primitives, BVHBuildMethod build_method = BVHBuildMethod::sah, Float split_budget = 0.3f
+    );
+
+    // bvh must have been built from primitives
+    CompressedBVH(const BVH& bvh, const std::vector<Intersectable*>& primitives);
+    CompressedBVH(const BVH& bvh, const std::vector<Primitive*>& primitives);
+
+    virtual AABB GetAABB() const override;
+    virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+
+    Float GetSAHCost() const;
+    int32 GetNodeCount() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Node
+    {
+        static constexpr int32 q_max = std::numeric_limits<T>::max();
+
+        static Float Dequantize(float origin, int32 q, int32 exponent);
+
+        void SetFrame(const AABB& aabb);
+        void SetChild(int32 child, const AABB& aabb, int32 offset, int32 count);
+        void SetEmpty(int32 child);
+
+        // Conservative bounds of the child, never smaller than the original box
+        AABB GetChildAABB(int32 child) const;
+
+        // Quantization frame: bound = origin + q * 2^exponent
+        float origin[3];
+        int8 exponent[3];
+        uint8 axis;
+
+        // [child][min|max][axis]
+        T bounds[2][2][3];
+
+        // Node index if count == 0, otherwise primitive offset of the leaf
+        // Negative offset marks an empty child
+        int32 offset[2];
+        uint16 count[2];
+    };
+
+    int32 Compress(const BVH& bvh, int32 binary_index);
+
+    template <typename P>
+    void SetReferences(const BVH& bvh, const std::vector<P*>& primitives);
+
+    Intersectable* GetPrimitive(int32 reference) const;
+
+    template <typename C>
+    void RayCast(const Ray& r, Float t_min, Float t_max, C* callback) const;
+
+    // Only one of the lists is set, scenes hand in their primitives directly
+    std::span<Intersectable* const> intersectables;
+    std::span<Primitive* const> scene_primitives;
+
+    std::vector<uint32> references;
+    std::vector<Node> nodes;
+    AABB aabb;
+};
+
+using CompressedBVH8 = CompressedBVH<uint8>;
+using CompressedBVH16 = CompressedBVH<uint16>;
+
+template <typename T>
+inline Intersectable* CompressedBVH<T>::GetPrimitive(int32 reference) const
+{
+    uint32 index = references[reference];
+    return scene_primitives.empty() ? intersectables[index] : scene_primitives[index];
+}
+
+template <typename T>
+inline Float CompressedBVH<T>::Node::Dequantize(float origin, int32 q, int32 exponent)
+{
+    // Product with a power of two is exact, so the only rounding happens in the addition
+    float scale = std::bit_cast<float>(uint32(exponent + 127) << 23);
+    return Float(origin + float(q) * scale);
+}
+
+template <typename T>
+inline AABB CompressedBVH<T>::Node::GetChildAABB(int32 child) const
+{
+    AABB child_aabb;
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        child_aabb.min[axis] = Dequantize(origin[axis], bounds[child][0][axis], exponent[axis]);
+        child_aabb.max[axis] = Dequantize(origin[axis], bounds[child][1][axis], exponent[axis]);
+    }
+
+    return child_aabb;
+}
+
+template <typename T>
+template <typename C>
+inline void CompressedBVH<T>::RayCast(const Ray& r, Float t_min, Float t_max, C* callback) const
+{
+    const Vec3 inv_dir(1 / r.d.x, 1 / r.d.y, 1 / r.d.z);
+    const int32 is_dir_neg[3] = { int32(inv_dir.x < 0), int32(inv_dir.y < 0), int32(inv_dir.z < 0) };
+
+    GrowableArray<int32, 64> stack;
+    stack.Emplace(0);
+
+    while (stack.Count() > 0)
+    {
+        const Node& node = nodes[stack.Pop()];
+
+        // Visit the near child first
+        int32 near_child = is_dir_neg[node.axis];
+        int32 internal_children[2];
+        int32 internal_count = 0;
+
+        for (int32 child : { near_child, 1 - near_child })
+        {
+            if (node.offset[child] < 0 || !node.GetChildAABB(child).TestRay(r.o, t_min, t_max, inv_dir, is_dir_neg))
+            {
+                continue;
+            }
+
+            if (node.count[child] == 0)
+            {
+                internal_children[internal_count++] = node.offset[child];
+                continue;
+            }
+
+            // Leaf node
+            for (int32 i = 0; i < node.count[child]; ++i)
+            {
+                Float t = callback->RayCastCallback(r, t_min, t_max, GetPrimitive(node.offset[child] + i));
+                if (t <= t_min)
+                {
+                    return;
+                }
+                else
+                {
+                    // Shorten the ray
+                    t_max = t;
+                }
+            }
+        }
+
+        // Put far child on stack first
+        while (internal_count > 0)
+        {
+            stack.Emplace(internal_children[--internal_count]);
+        }
+    }
+}
+
+} // namespace bulbit
@@ -34,6 +34,37 @@ public:
         const Primitive* primitive;
     };
 
+    // Flattened copy of the tree for rendering, stays valid while the tree is edited
+    class Snapshot : public Intersectable
+    {
+    public:
+        virtual AABB GetAABB() const override;
+        virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
+        virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+
+        int32 GetNodeCount() const;
+
+    private:
+        friend class DynamicBVH;
+
+        // First child follows its parent, the second one is at offset
+        struct alignas(32) LinearNode
+        {
+            AABB aabb;
+
+            // Second child of internal nodes, primitive index of leaves
+            int32 offset;
+            bool leaf;
+            uint8 axis;
+        };
+
+        template <typename T>
+        void RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const;
+
+        std::vector<LinearNode> nodes;
+        std::vector<const Primitive*> primitives;
+    };
+
     DynamicBVH();
     DynamicBVH(const std::vector<Primitive*>& primitives);
 
@@ -53,6 +84,12 @@ public:
     bool MoveNode(NodeIndex node, AABB aabb, const Vec3& displacement, bool force_move);
     void RemoveNode(NodeIndex node);
 
+    // Batch versions for bulk edits, leaves are inserted in Morton order and large batches rebuild the tree
+    void CreateNodes(std::span<const Primitive* const> primitives, std::span<const AABB> aabbs, NodeIndex* out_nodes);
+    int32 MoveNodes(
+        std::span<const NodeIndex> leaves, std::span<const AABB> aabbs, std::span<const Vec3> displacements, bool force_move
+    );
+
     bool TestOverlap(NodeIndex nodeA, NodeIndex nodeB) const;
     const AABB& GetAABB(NodeIndex node) const;
     void ClearMoved(NodeIndex node) const;
@@ -72,6 +109,9 @@ public:
 
     void Rebuild();
 
+    // Reuses the memory of the given snapshot
+    void Flatten(Snapshot* snapshot) const;
+
 private:
     friend class Scene;
 
@@ -89,10 +129,17 @@ private:
     NodeIndex InsertLeaf(NodeIndex leaf);
     void RemoveLeaf(NodeIndex leaf);
 
+    // Sorted insertion keeps the sibling searches of consecutive leaves in the same part of the tree
+    void InsertLeaves(std::span<const NodeIndex> leaves);
+
+    // Large batches are cheaper to rebuild from scratch than to insert one by one
+    static bool ShouldRebuild(int32 batch_count, int32 leaf_count);
+
     void Rotate(NodeIndex node);
     void Swap(NodeIndex node1, NodeIndex node2);
 
     static Float SAH(const AABB& aabb);
+    static AABB Extend(AABB aabb, const Vec3& displacement);
 };
 
 inline Float DynamicBVH::SAH(const AABB& aabb)
@@ -104,6 +151,34 @@ inline Float DynamicBVH::SAH(const AABB& aabb)
 #endif
 }
 
+inline AABB DynamicBVH::Extend(AABB aabb, const Vec3& d)
+{
+    if (d.x > 0.0f)
+    {
+        aabb.max.x += d.x;
+    }
+    else
+    {
+        aabb.min.x += d.x;
+    }
+
+    if (d.y > 0.0f)
+    {
+        aabb.max.y += d.y;
+    }
+    else
+    {
+        aabb.min.y += d.y;
+    }
+
+    return aabb;
+}
+
+inline bool DynamicBVH::ShouldRebuild(int32 batch_count, int32 leaf_count)
+{
+    return leaf_count > 1 && batch_count * 4 > leaf_count;
+}
+
 inline bool DynamicBVH::TestOverlap(NodeIndex nodeA, NodeIndex nodeB) const
 {
     BulbitAssert(0 <= nodeA && nodeA < nodeCapacity);
@@ -315,4 +390,58 @@ void DynamicBVH::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) co
     }
 }
 
+template <typename T>
+void DynamicBVH::Snapshot::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    const Vec3 inv_dir(1 / r.d.x, 1 / r.d.y, 1 / r.d.z);
+    const int32 is_dir_neg[3] = { int32(inv_dir.x < 0), int32(inv_dir.y < 0), int32(inv_dir.z < 0) };
+
+    GrowableArray<int32, 64> stack;
+    stack.Emplace(0);
+
+    while (stack.Count() > 0)
+    {
+        int32 index = stack.Pop();
+        const LinearNode& node = nodes[index];
+
+        if (!node.aabb.TestRay(r.o, t_min, t_max, inv_dir, is_dir_neg))
+        {
+            continue;
+        }
+
+        if (node.leaf)
+        {
+            Float t = callback->RayCastCallback(r, t_min, t_max, primitives[node.offset]);
+            if (t <= t_min)
+            {
+                return;
+            }
+            else
+            {
+                // Shorten the ray
+                t_max = t;
+            }
+        }
+        else
+        {
+            // Put far child on stack first
+            if (is_dir_neg[node.axis])
+            {
+                stack.Emplace(index + 1);
+                stack.Emplace(node.offset);
+            }
+            else
+            {
+                stack.Emplace(node.offset);
+                stack.Emplace(index + 1);
+            }
+        }
+    }
+}
+
 } // namespace bulbit
\ No newline at end of file
@@ -114,40 +114,42 @@ public:
     T* Cast()
     {
         BulbitAssert(Is<T>());
-        return reinterpret_cast<T*>(this);
+        return static_cast<T*>(this);
     }
 
     template <typename T>
     const T* Cast() const
     {
         BulbitAssert(Is<T>());
-        return reinterpret_cast<const T*>(this);
+        return static_cast<const T*>(this);
     }
 
+    // Downcasting from the dispatcher instead of void* keeps the pointer right when the dispatcher is not at the start
+    // of the object, as in classes that also have virtual functions
     template <typename Func>
     auto Dispatch(Func&& func)
     {
         using R = detail::ReturnType<Func, Types...>::type;
-        using Handler = R (*)(void*, Func&&);
+        using Handler = R (*)(DynamicDispatcher*, Func&&);
 
-        static constexpr Handler handlers[] = { [](void* p, Func&& f) -> R {
+        static constexpr Handler handlers[] = { [](DynamicDispatcher* p, Func&& f) -> R {
             return f(static_cast<std::add_pointer_t<Types>>(p));
         }... };
 
-        return handlers[type_index]((void*)this, std::forward<Func>(func));
+        return handlers[type_index](this, std::forward<Func>(func));
     }
 
     template <typename Func>
     auto Dispatch(Func&& func) const
     {
         using R = detail::ReturnType<Func, Types...>::type;
-        using Handler = R (*)(void*, Func&&);
+        using Handler = R (*)(DynamicDispatcher*, Func&&);
 
-        static constexpr Handler handlers[] = { [](void* p, Func&& f) -> R {
+        static constexpr Handler handlers[] = { [](DynamicDispatcher* p, Func&& f) -> R {
             return f(static_cast<std::add_pointer_t<Types>>(p));
         }... };
 
-        return handlers[type_index]((void*)this, std::forward<Func>(func));
+        return handlers[type_index](const_cast<DynamicDispatcher*>(this), std::forward<Func>(func));
     }
 
     template <typename T>
@@ -1,11 +1,49 @@
 #pragma once
 
+#include "bounding_box.h"
 #include "image.h"
 
 namespace bulbit
 {
 
 class Camera;
+class Film;
+
+// Private accumulation buffer of one thread, see Film::MergeTile
+// Samples must lie inside the tile bounds, splats may land anywhere on the film
+class FilmTile
+{
+public:
+    // Tile that only collects splats
+    FilmTile(Film* film);
+    FilmTile(Film* film, const AABB2i& bounds);
+
+    void AddSample(const Point2i& pixel, const Spectrum& L);
+    void AddSplat(const Point2& pixel, const Spectrum& L);
+
+    const AABB2i& GetBounds() const;
+
+private:
+    friend class Film;
+
+    // Filtered splats are flushed to the film once this many pixel contributions are pending
+    static constexpr size_t max_pending_splats = 65536;
+
+    struct Splat
+    {
+        int32 index;
+        Spectrum L;
+    };
+
+    Film* film;
+    AABB2i bounds;
+
+    std::vector<Spectrum> samples;
+    std::vector<int32> sample_counts;
+    std::vector<Point2> moments;
+
+    std::vector<Splat> splats;
+};
 
 class Film
 {
@@ -15,21 +53,42 @@ public:
     void AddSample(const Point2i& pixel, const Spectrum& L);
     void AddSplat(const Point2& pixel, const Spectrum& L);
 
+    // Adds the samples and splats of the tile to the film and clears the tile for reuse
+    // Samples are written without synchronization, so tiles merged at the same time must not overlap
+    void MergeTile(FilmTile* tile);
+
     void WeightSplats(Float weight);
 
     Image3 GetRenderedImage() const;
     Image1 GetVarianceImage() const;
 
+    // Standard error of the mean luminance relative to the mean
+    Image1 GetRelativeErrorImage() const;
+
 private:
+    friend class FilmTile;
+
+    // Calls fcn(index, weight) for every film pixel in the filter footprint of the splat
+    template <typename F>
+    void ForEachSplatPixel(const Point2& pixel, F&& fcn) const;
+
+    void MergeSplats(std::vector<FilmTile::Splat>* splats);
+
     const Camera* camera;
 
     std::unique_ptr<Spectrum[]> samples;
     std::unique_ptr<int32[]> sample_counts;
 
-    std::unique_ptr<std::atomic<Float>[]> splats;
+    // Splats from different threads are added through std::atomic_ref
+    std::unique_ptr<Float[]> splats;
 
     // luminance moments (l, l^2)
     std::unique_ptr<Point2[]> moments;
 };
 
+inline const AABB2i& FilmTile::GetBounds() const
+{
+    return bounds;
+}
+
 } // namespace bulbit
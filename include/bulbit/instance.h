@@ -0,0 +1,38 @@
+#pragma once
+
+#include "intersectable.h"
+#include "transform.h"
+
+namespace bulbit
+{
+
+// Places a shared object, defined in its own object space, into the world
+class Instance : public Intersectable
+{
+public:
+    Instance(const Intersectable* object, const Transform& transform);
+
+    virtual AABB GetAABB() const override;
+    virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+
+    const Intersectable* GetObject() const;
+    const Transform& GetTransform() const;
+
+private:
+    const Intersectable* object;
+    Transform transform;
+    AABB aabb;
+};
+
+inline const Intersectable* Instance::GetObject() const
+{
+    return object;
+}
+
+inline const Transform& Instance::GetTransform() const
+{
+    return transform;
+}
+
+} // namespace bulbit
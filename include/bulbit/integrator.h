@@ -9,7 +9,7 @@ namespace bulbit
 class Rendering;
 class Medium;
 class Camera;
-class Film;
+class FilmTile;
 class Sampler;
 class LightSampler;
 
@@ -94,6 +94,14 @@ protected:
     std::unique_ptr<LightSampler> light_sampler;
 };
 
+// Closest hit of a camera ray found by batched traversal, isect points into the batch and is only read if found
+struct PrimaryHit
+{
+    bool valid = false;
+    bool found = false;
+    const Intersection* isect = nullptr;
+};
+
 class UniDirectionalRayIntegrator : public Integrator
 {
 public:
@@ -106,10 +114,49 @@ public:
 
     virtual Rendering* Render(Allocator& alloc, const Camera* camera) override;
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const = 0;
+    // primary_hit is nullptr when the camera ray has not been traced in advance
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const = 0;
+
+    // Renders the whole frame in passes of pass_spp samples if pass_spp is positive and publishes a film snapshot
+    // after a pass once snapshot_interval seconds have passed
+    // Passes after the first one stop starting tiles after time_limit seconds
+    void SetProgressive(int32 pass_spp, Float time_limit, Float snapshot_interval);
+
+    // After a uniform warmup pass, distributes the remaining samples of the frame in proportion to the relative error
+    // of each pixel, pixels whose error is below the threshold receive no more samples
+    void SetAdaptiveSampling(Float threshold);
+
+    // Sorts the camera ray hits of a tile by material before shading them
+    void SetHitSorting(bool enabled);
+
+protected:
+    using Integrator::Intersect;
+
+    // Consumes the precomputed hit of the camera ray on the first query, traces the ray otherwise
+    bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max, PrimaryHit* primary_hit) const
+    {
+        if (primary_hit && primary_hit->valid)
+        {
+            primary_hit->valid = false;
+            if (primary_hit->found)
+            {
+                *out_isect = *primary_hit->isect;
+            }
+
+            return primary_hit->found;
+        }
+
+        return Intersect(out_isect, ray, t_min, t_max);
+    }
 
 private:
     const Sampler* sampler_prototype;
+
+    int32 pass_spp = 0;
+    Float time_limit = 0;
+    Float snapshot_interval = 0;
+    Float adaptive_threshold = 0;
+    bool sort_hits = false;
 };
 
 class BiDirectionalRayIntegrator : public Integrator
@@ -124,7 +171,9 @@ public:
 
     virtual Rendering* Render(Allocator& alloc, const Camera* camera) override;
 
-    virtual Spectrum L(const Ray& ray, const Medium* medium, const Camera* camera, Film& film, Sampler& sampler) const = 0;
+    virtual Spectrum L(
+        const Ray& ray, const Medium* medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
+    ) const = 0;
 
 private:
     const Sampler* sampler_prototype;
@@ -15,7 +15,7 @@ class DebugIntegrator : public UniDirectionalRayIntegrator
 public:
     DebugIntegrator(const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler);
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 };
 
 class RandomWalkIntegrator : public UniDirectionalRayIntegrator
@@ -23,7 +23,7 @@ class RandomWalkIntegrator : public UniDirectionalRayIntegrator
 public:
     RandomWalkIntegrator(const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler, int32 max_bounces);
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 
 private:
     int32 max_bounces;
@@ -34,7 +34,7 @@ class AOIntegrator : public UniDirectionalRayIntegrator
 public:
     AOIntegrator(const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler, Float ao_range);
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 
 private:
     // maximum range to consider occlusuion
@@ -46,7 +46,7 @@ class AlbedoIntegrator : public UniDirectionalRayIntegrator
 public:
     AlbedoIntegrator(const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler);
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 };
 
 // Whitted-style raytracer
@@ -55,15 +55,15 @@ class WhittedStyle : public UniDirectionalRayIntegrator
 public:
     WhittedStyle(const Intersectable* accel, std::vector<Light*> lights, const Sampler* sampler, int32 max_depth);
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override
     {
         BulbitNotUsed(medium);
 
-        return Li(ray, sampler, 0);
+        return Li(ray, sampler, 0, primary_hit);
     }
 
 private:
-    Spectrum Li(const Ray& ray, Sampler& sampler, int32 depth) const;
+    Spectrum Li(const Ray& ray, Sampler& sampler, int32 depth, PrimaryHit* primary_hit = nullptr) const;
 
     int32 max_depth;
 };
@@ -79,7 +79,7 @@ public:
         int32 rr_min_bounces = 1
     );
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 
 private:
     Spectrum Li(const Ray& ray, Sampler& sampler, int32 depth) const;
@@ -101,7 +101,7 @@ public:
         bool regularize_bsdf = false
     );
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 
 private:
     Spectrum SampleDirectLight(
@@ -113,6 +113,30 @@ private:
     bool regularize_bsdf;
 };
 
+// Same estimator as PathIntegrator, but a wave of paths advances one bounce at a time in stages
+// (intersect, shade grouped by material, trace shadow rays) instead of tracing each path to the end
+class WavefrontPathIntegrator : public Integrator
+{
+public:
+    WavefrontPathIntegrator(
+        const Intersectable* accel,
+        std::vector<Light*> lights,
+        const Sampler* sampler,
+        int32 max_bounces,
+        int32 rr_min_bounces = 1,
+        bool regularize_bsdf = false
+    );
+
+    virtual Rendering* Render(Allocator& alloc, const Camera* camera) override;
+
+private:
+    const Sampler* sampler_prototype;
+
+    int32 max_bounces;
+    int32 rr_min_bounces;
+    bool regularize_bsdf;
+};
+
 class NaiveVolPathIntegrator : public UniDirectionalRayIntegrator
 {
 public:
@@ -124,7 +148,7 @@ public:
         int32 rr_min_bounces = 1
     );
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 
 private:
     int32 max_bounces;
@@ -143,7 +167,7 @@ public:
         bool regularize_bsdf = false
     );
 
-    virtual Spectrum Li(const Ray& ray, const Medium* medium, Sampler& sampler) const override;
+    virtual Spectrum Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const override;
 
 private:
     Spectrum SampleDirectLight(
@@ -228,7 +252,9 @@ public:
         int32 rr_min_bounces = 1
     );
 
-    virtual Spectrum L(const Ray& ray, const Medium* medium, const Camera* camera, Film& film, Sampler& sampler) const override;
+    virtual Spectrum L(
+        const Ray& ray, const Medium* medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
+    ) const override;
 
 private:
     int32 max_bounces;
@@ -246,7 +272,9 @@ public:
         int32 rr_min_bounces = 1
     );
 
-    virtual Spectrum L(const Ray& ray, const Medium* medium, const Camera* camera, Film& film, Sampler& sampler) const override;
+    virtual Spectrum L(
+        const Ray& ray, const Medium* medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
+    ) const override;
 
 private:
     int32 max_bounces;
@@ -266,7 +294,9 @@ public:
         int32 rr_min_bounces = 1
     );
 
-    virtual Spectrum L(const Ray& ray, const Medium* medium, const Camera* camera, Film& film, Sampler& sampler) const override;
+    virtual Spectrum L(
+        const Ray& ray, const Medium* medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
+    ) const override;
 
 private:
     int32 SampleCameraPath(Vertex* path, const Ray& ray, const Camera* camera, Sampler& sampler, Allocator& alloc) const;
@@ -287,7 +317,9 @@ public:
         int32 rr_min_bounces = 1
     );
 
-    virtual Spectrum L(const Ray& ray, const Medium* medium, const Camera* camera, Film& film, Sampler& sampler) const override;
+    virtual Spectrum L(
+        const Ray& ray, const Medium* medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
+    ) const override;
 
 private:
     int32 SampleCameraPath(
@@ -2,6 +2,7 @@
 
 #include "allocator.h"
 #include "bounding_box.h"
+#include "hash.h"
 #include "spectrum.h"
 
 namespace bulbit
@@ -42,6 +43,45 @@ public:
     virtual AABB GetAABB() const = 0;
     virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const = 0;
     virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const = 0;
+
+    // Batched queries, implementations may traverse coherent rays together
+    // out_hits[i] tells whether rays[i] hit anything, out_isects[i] is only written on hit
+    virtual void IntersectN(
+        std::span<Intersection> out_isects, std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, Float t_max
+    ) const
+    {
+        for (size_t i = 0; i < rays.size(); ++i)
+        {
+            out_hits[i] = Intersect(&out_isects[i], rays[i], t_min, t_max);
+        }
+    }
+
+    // Each ray has its own t_max, e.g. shadow rays towards different points
+    virtual void IntersectAnyN(
+        std::span<bool> out_hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max
+    ) const
+    {
+        for (size_t i = 0; i < rays.size(); ++i)
+        {
+            out_hits[i] = IntersectAny(rays[i], t_min, t_max[i]);
+        }
+    }
+
+    // Bounds of the part of the object that lies within the slab [min, max] along the axis
+    virtual AABB GetClippedAABB(int32 axis, Float min, Float max) const
+    {
+        AABB aabb = GetAABB();
+        aabb.min[axis] = std::max(aabb.min[axis], min);
+        aabb.max[axis] = std::min(aabb.max[axis], max);
+        return aabb;
+    }
+
+    // Hash of everything the bounds above depend on, used to validate cached acceleration structures
+    virtual uint64 GetGeometryHash() const
+    {
+        AABB aabb = GetAABB();
+        return HashBuffer(&aabb, sizeof(AABB));
+    }
 };
 
 } // namespace bulbit
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "hash.h"
+#include "vectors.h"
+
+namespace bulbit
+{
+
+constexpr inline uint32 ReverseBits32(uint32 v)
+{
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+    v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+    v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+    v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+    return v;
+}
+
+// Hash based Owen scrambling, each digit is flipped depending on the digits above it
+// https://psychopath.io/post/2021_01_30_building_a_better_lk_hash
+struct FastOwenScrambler
+{
+    uint32 seed;
+
+    uint32 operator()(uint32 v) const
+    {
+        v = ReverseBits32(v);
+        v ^= v * 0x3d20adea;
+        v += seed;
+        v *= (seed >> 16) | 1;
+        v ^= v * 0x05526c56;
+        v ^= v * 0x53a22864;
+        return ReverseBits32(v);
+    }
+};
+
+// Columns of the generator matrix of the second Sobol dimension, the Pascal matrix mod 2
+// The first dimension is the van der Corput sequence, together they form a (0, 2)-sequence
+constexpr inline std::array<uint32, 64> sobol_matrix_1 = []() {
+    std::array<uint32, 64> columns{};
+    columns[0] = 1u << 31;
+    for (size_t i = 1; i < columns.size(); ++i)
+    {
+        columns[i] = columns[i - 1] ^ (columns[i - 1] >> 1);
+    }
+    return columns;
+}();
+
+// Unscrambled 32 bit fixed point sample of the first (dimension 0) or second (dimension 1) Sobol dimension
+inline uint32 SobolBits(uint64 index, int32 dimension)
+{
+    BulbitAssert(dimension == 0 || dimension == 1);
+
+    if (dimension == 0)
+    {
+        return ReverseBits32(uint32(index));
+    }
+
+    uint32 v = 0;
+    for (int32 i = 0; index != 0; index >>= 1, ++i)
+    {
+        if (index & 1)
+        {
+            v ^= sobol_matrix_1[i];
+        }
+    }
+
+    return v;
+}
+
+template <typename Scrambler>
+inline Float SobolSample(uint64 index, int32 dimension, Scrambler scrambler)
+{
+    uint32 v = scrambler(SobolBits(index, dimension));
+    return std::fmin(1 - epsilon, Float(v * 0x1p-32f));
+}
+
+// Points of fully Owen scrambled (0, 2)-sequences, which are distributed like PMJ02 sequences (Helmer et al. 2021)
+// The tables are generated once on first use and only read afterwards
+constexpr int32 pmj02_set_count = 32;
+constexpr int32 pmj02_set_size = 4096;
+
+Point2 GetPMJ02Sample(int32 set, int32 index);
+
+// Tileable blue noise texture made with the void and cluster method, values are the pixel ranks mapped to [0, 1)
+// Texture indices select differently shifted copies of the same texture
+constexpr int32 blue_noise_resolution = 64;
+
+Float GetBlueNoise(int32 texture, Point2i pixel);
+
+} // namespace bulbit
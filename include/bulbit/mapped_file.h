@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+
+namespace bulbit
+{
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::filesystem::path& filename);
+    void Close();
+
+    const void* GetData() const;
+    size_t GetSize() const;
+
+private:
+    const void* data = nullptr;
+    size_t size = 0;
+
+#if defined(_WIN32)
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+inline MappedFile::~MappedFile()
+{
+    Close();
+}
+
+inline const void* MappedFile::GetData() const
+{
+    return data;
+}
+
+inline size_t MappedFile::GetSize() const
+{
+    return size;
+}
+
+} // namespace bulbit
@@ -133,4 +133,69 @@ constexpr inline int32 FindInterval(int32 size, const Predicate& pred)
     return Clamp(first - 1, 0, size - 2);
 }
 
+// Spread the lower 10 bits so that there are two zero bits between each
+constexpr inline uint32 LeftShift3(uint32 x)
+{
+    if (x == (1 << 10))
+    {
+        --x;
+    }
+
+    x = (x | (x << 16)) & 0b00000011000000000000000011111111;
+    x = (x | (x << 8)) & 0b00000011000000001111000000001111;
+    x = (x | (x << 4)) & 0b00000011000011000011000011000011;
+    x = (x | (x << 2)) & 0b00001001001001001001001001001001;
+
+    return x;
+}
+
+constexpr inline uint32 EncodeMorton3(uint32 x, uint32 y, uint32 z)
+{
+    return (LeftShift3(z) << 2) | (LeftShift3(y) << 1) | LeftShift3(x);
+}
+
+// Spread the lower 32 bits so that there is a zero bit between each
+constexpr inline uint64 LeftShift2(uint64 x)
+{
+    x &= 0xffffffff;
+    x = (x ^ (x << 16)) & 0x0000ffff0000ffff;
+    x = (x ^ (x << 8)) & 0x00ff00ff00ff00ff;
+    x = (x ^ (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x ^ (x << 2)) & 0x3333333333333333;
+    x = (x ^ (x << 1)) & 0x5555555555555555;
+
+    return x;
+}
+
+constexpr inline uint64 EncodeMorton2(uint32 x, uint32 y)
+{
+    return (LeftShift2(y) << 1) | LeftShift2(x);
+}
+
+// Distance along the Hilbert curve filling the grid of size n x n, n must be a power of two
+constexpr inline uint32 EncodeHilbert2(uint32 x, uint32 y, uint32 n)
+{
+    uint32 d = 0;
+    for (uint32 s = n / 2; s > 0; s /= 2)
+    {
+        uint32 rx = (x & s) > 0;
+        uint32 ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so that the curve is continuous
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+
+            std::swap(x, y);
+        }
+    }
+
+    return d;
+}
+
 } // namespace bulbit
\ No newline at end of file
@@ -31,9 +31,15 @@ public:
 
     int32 GetTriangleCount() const;
 
+    // Replaces the vertex attributes in place for animation, the topology stays the same
+    // BVHs built over the mesh have to be refitted afterwards
+    void SetPositions(std::span<const Point3> positions, const Mat4& transform);
+    void SetNormals(std::span<const Vec3> normals, std::span<const Vec3> tangents, const Mat4& transform);
+
 private:
     friend class Scene;
     friend class Triangle;
+    friend class BVH;
 
     int32 triangle_count;
     std::vector<Point3> positions;
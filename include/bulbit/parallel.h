@@ -7,45 +7,54 @@ namespace bulbit
 
 class ThreadPool;
 
+// Logical processors of each NUMA node that the process may run on
+// Platforms without NUMA information report a single node
+std::vector<std::vector<int32>> GetNumaNodes();
+
+// Pins the calling thread to a logical processor, returns false if that is not supported
+bool SetThreadAffinity(int32 processor);
+
+// Parses lists in the format of the Linux cpulist files, e.g. "0-3,8,10-11"
+bool ParseIndexList(std::string_view list, std::vector<int32>* out_indices);
+
 class ParallelJob
 {
 public:
     virtual ~ParallelJob() = default;
 
-    virtual bool HaveWork() const = 0;
-    virtual void RunStep(std::unique_lock<std::mutex>* lock) = 0;
-
-    bool Finished() const
-    {
-        return !HaveWork() && active_workers == 0;
-    }
+    // Called once for every time the job was submitted, by whichever thread popped or stole it
+    virtual void Run() = 0;
 
 protected:
     friend class ThreadPool;
-    ThreadPool* thread_pool;
-
-private:
-    // Active threads working on this job
-    int32 active_workers = 0;
-
-    // Links
-    ParallelJob* prev = nullptr;
-    ParallelJob* next = nullptr;
+    ThreadPool* thread_pool = nullptr;
 };
 
+// Work-stealing thread pool
+// Every thread has its own deque of jobs, it pushes and pops at the bottom while idle threads steal from the top.
+// Threads that are not part of the pool get one of a few external deques on their first submission.
 class ThreadPool
 {
 public:
     inline static std::unique_ptr<ThreadPool> global_thread_pool = nullptr;
 
     explicit ThreadPool(int32 worker_count);
+
+    // Pins the calling thread to processors[0] and the workers to the following ones
+    // Idle threads steal from threads on the same NUMA node first
+    ThreadPool(int32 worker_count, std::span<const int32> processors);
     ~ThreadPool();
 
-    void WorkOrWait(std::unique_lock<std::mutex>* lock);
-    bool WorkOrReturn();
+    // Pushes the job count times to the deque of the calling thread and wakes up idle workers
+    // Returns false if there is no deque left for the calling thread, the caller has to run the job itself then
+    bool Submit(ParallelJob* job, int32 count = 1);
+
+    // Runs one job from the own deque or a stolen one, returns false if there was nothing to do
+    bool RunPendingJob();
 
-    std::unique_lock<std::mutex> AddJob(ParallelJob* job);
-    void RemoveJob(ParallelJob* job);
+    // Blocks until Notify is called if done() is false and there is nothing to steal
+    void Park(const std::function<bool(void)>& done);
+    void Notify();
 
     void ForEachThread(std::function<void(void)> func);
 
@@ -54,32 +63,68 @@ public:
         return int32(threads.size() + 1);
     }
 
+    // Dense index in [0, ThreadIndexCount()) of the calling thread, -1 if it has no deque of this pool
+    // Workers and the threads submitting work have one, see ThreadLocal
+    int32 GetThreadIndex()
+    {
+        return FindSlotIndex();
+    }
+
+    int32 ThreadIndexCount() const
+    {
+        return slot_count;
+    }
+
 private:
-    void Worker();
+    struct Slot;
+    struct ExternalSlotGuard;
+
+    void Worker(int32 index);
 
-    bool shutdown = false;
+    // Returns the deque of the calling thread, GetSlotIndex also claims a free external one if it has none
+    int32 FindSlotIndex();
+    int32 GetSlotIndex();
+    ParallelJob* Steal(int32 thief);
+    bool HasWork() const;
+
+    std::vector<int32> processors;
+    bool numa_aware = false;
+
+    std::atomic<bool> shutdown = false;
 
     std::vector<std::thread> threads;
-    std::mutex mutex;
-    std::condition_variable job_list_condition;
 
-    ParallelJob* job_list = nullptr;
+    // Worker deques followed by the external ones
+    // Shared so that threads holding an external deque can release it on exit even if the pool is gone
+    int32 slot_count;
+    std::shared_ptr<Slot[]> slots;
+
+    // Bumped on every submission and completion, parked threads wait for it to change
+    std::atomic<uint32> epoch = 0;
+    std::atomic<int32> sleeping = 0;
 };
 
+// Per-thread values indexed by the dense thread index of a pool, so that lookups are lock-free
+// Threads without an index, e.g. when there is no pool, fall back to a locked table
+// The index of an exited thread is released, the next thread taking it keeps using the same value
 template <typename T>
 class ThreadLocal
 {
 public:
-    ThreadLocal()
-        : hash_table{ 4 * std::thread::hardware_concurrency() }
-        , createFcn{ []() { return T(); } }
+    ThreadLocal(ThreadPool* thread_pool = ThreadPool::global_thread_pool.get())
+        : ThreadLocal([]() { return T(); }, thread_pool)
     {
     }
 
-    ThreadLocal(std::function<T(void)> createFcn)
-        : hash_table{ 4 * std::thread::hardware_concurrency() }
+    ThreadLocal(std::function<T(void)> createFcn, ThreadPool* thread_pool = ThreadPool::global_thread_pool.get())
+        : thread_pool{ thread_pool }
         , createFcn{ std::move(createFcn) }
     {
+        if (thread_pool)
+        {
+            entry_count = thread_pool->ThreadIndexCount();
+            entries = std::make_unique<Entry[]>(entry_count);
+        }
     }
 
     T& Get();
@@ -87,110 +132,99 @@ public:
     void ForEach(std::function<void(std::thread::id tid, T& value)>&& callback);
 
 private:
-    struct Entry
+    // Padded to keep the values of different threads off the same cache line
+    struct alignas(64) Entry
     {
         std::thread::id tid;
-        T value;
+        std::optional<T> value;
     };
 
-    std::shared_mutex mutex;
-    std::vector<std::optional<Entry>> hash_table;
+    T& Create(Entry* entry);
+    T& GetFallback();
+
+    ThreadPool* thread_pool;
+
+    int32 entry_count = 0;
+    std::unique_ptr<Entry[]> entries;
+
+    // Guards value creation and the fallback entries
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Entry>> fallback_entries;
+
     std::function<T(void)> createFcn;
 };
 
 template <typename T>
 inline T& ThreadLocal<T>::Get()
 {
-    const std::thread::id tid = std::this_thread::get_id();
-    size_t hash = std::hash<std::thread::id>()(tid);
-    hash %= hash_table.size();
-
-    int32 step = 1;
-    int32 tries = 0;
-    BulbitNotUsed(tries);
-
-    mutex.lock_shared();
-    while (true)
+    int32 index = thread_pool ? thread_pool->GetThreadIndex() : -1;
+    if (index < 0)
     {
-        BulbitAssert(size_t(tries) < hash_table.size());
-
-        if (hash_table[hash].has_value())
-        {
-            if (hash_table[hash]->tid == tid)
-            {
-                // Found
-                T& local_value = hash_table[hash]->value;
-                mutex.unlock_shared();
-                return local_value;
-            }
-            else
-            {
-                // Check the next bucket
-                hash += step;
-                ++step;
-
-                if (hash >= hash_table.size())
-                {
-                    hash %= hash_table.size();
-                }
-
-                ++tries;
-                continue;
-            }
-        }
-        else
-        {
-            // First access
-
-            // We get exclusive lock before calling callback so that the user
-            // doesn't have to worry about writing a thread-safe callback.
-            mutex.unlock_shared();
-            mutex.lock();
+        return GetFallback();
+    }
 
-            T new_value = createFcn();
+    // Only the thread owning the index accesses the entry
+    Entry& entry = entries[index];
+    if (entry.value.has_value())
+    {
+        return *entry.value;
+    }
 
-            if (hash_table[hash].has_value())
-            {
-                // Resolve hash collsion by linear probing.
-                while (true)
-                {
-                    hash += step;
-                    ++step;
+    return Create(&entry);
+}
 
-                    if (hash >= hash_table.size())
-                    {
-                        hash %= hash_table.size();
-                    }
+template <typename T>
+inline T& ThreadLocal<T>::Create(Entry* entry)
+{
+    // We get exclusive lock before calling callback so that the user
+    // doesn't have to worry about writing a thread-safe callback.
+    std::lock_guard<std::mutex> lock(mutex);
 
-                    if (!hash_table[hash].has_value())
-                    {
-                        break;
-                    }
-                }
-            }
+    entry->tid = std::this_thread::get_id();
+    entry->value.emplace(createFcn());
 
-            hash_table[hash].emplace(tid, std::move(new_value));
-            T& local_value = hash_table[hash]->value;
+    return *entry->value;
+}
 
-            mutex.unlock();
+template <typename T>
+inline T& ThreadLocal<T>::GetFallback()
+{
+    const std::thread::id tid = std::this_thread::get_id();
 
-            return local_value;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::unique_ptr<Entry>& entry : fallback_entries)
+    {
+        if (entry->tid == tid)
+        {
+            return *entry->value;
         }
     }
+
+    // Entries are allocated one by one so that the references stay valid as the list grows
+    Entry* entry = fallback_entries.emplace_back(std::make_unique<Entry>()).get();
+    entry->tid = tid;
+    entry->value.emplace(createFcn());
+
+    return *entry->value;
 }
 
 template <typename T>
 inline void ThreadLocal<T>::ForEach(std::function<void(std::thread::id tid, T& value)>&& callback)
 {
-    mutex.lock();
-    for (auto& entry : hash_table)
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (int32 i = 0; i < entry_count; ++i)
     {
-        if (entry.has_value())
+        if (entries[i].value.has_value())
         {
-            callback(entry->tid, entry->value);
+            callback(entries[i].tid, *entries[i].value);
         }
     }
-    mutex.unlock();
+
+    for (std::unique_ptr<Entry>& entry : fallback_entries)
+    {
+        callback(entry->tid, *entry->value);
+    }
 }
 
 } // namespace bulbit
@@ -6,80 +6,168 @@
 namespace bulbit
 {
 
-class ParallelForLoop : public ParallelJob
+// Chunk claiming and completion tracking shared by all loop bodies
+class ParallelForLoopBase : public ParallelJob
 {
 public:
-    ParallelForLoop(int32 begin_index, int32 end_index, int32 chunk_size, std::function<void(int32, int32)> func)
-        : func{ std::move(func) }
-        , next_index{ begin_index }
+    ParallelForLoopBase(int32 begin_index, int32 end_index, int32 chunk_size)
+        : next_index{ begin_index }
         , end_index{ end_index }
         , chunk_size{ chunk_size }
     {
         BulbitAssert(begin_index < end_index);
     }
 
-    virtual bool HaveWork() const override
+    // Submits the loop once for every thread that can help, runs it on the calling thread as well
+    // and returns after all chunks are done
+    void Execute(ThreadPool* thread_pool);
+
+    bool Finished() const
+    {
+        return pending.load() == 0;
+    }
+
+protected:
+    // Returns false once all chunks are taken
+    bool NextChunk(int32* chunk_begin, int32* chunk_end)
     {
-        return next_index < end_index;
+        int64 index_begin = next_index.fetch_add(chunk_size, std::memory_order_relaxed);
+        if (index_begin >= end_index)
+        {
+            return false;
+        }
+
+        *chunk_begin = int32(index_begin);
+        *chunk_end = int32(std::min<int64>(index_begin + chunk_size, end_index));
+        return true;
     }
 
-    virtual void RunStep(std::unique_lock<std::mutex>* lock) override;
+    // Called at the end of every Run, the loop may be destroyed right after the last one
+    void Retire();
 
 private:
-    std::function<void(int32, int32)> func;
-    int32 next_index;
+    std::atomic<int64> next_index;
     const int32 end_index;
     int32 chunk_size;
+
+    // Runs that have not returned yet, one for every submission and one for the calling thread
+    std::atomic<int32> pending = 1;
 };
 
-void ParallelFor(
-    int32 begin,
-    int32 end,
-    std::function<void(int32 begin, int32 end)> func,
-    ThreadPool* thread_pool = ThreadPool::global_thread_pool.get()
-);
+// Every thread that runs the loop keeps claiming chunks until all of them are taken
+// The body is called directly, per element if it takes one index and per chunk if it takes a range
+template <typename F>
+class ParallelForLoop : public ParallelForLoopBase
+{
+public:
+    ParallelForLoop(int32 begin_index, int32 end_index, int32 chunk_size, F& func)
+        : ParallelForLoopBase(begin_index, end_index, chunk_size)
+        , func{ func }
+    {
+    }
 
-inline void ParallelFor(
-    int32 begin, int32 end, std::function<void(int32 i)> func, ThreadPool* thread_pool = ThreadPool::global_thread_pool.get()
-)
+    virtual void Run() override
+    {
+        int32 chunk_begin, chunk_end;
+        while (NextChunk(&chunk_begin, &chunk_end))
+        {
+            if constexpr (std::is_invocable_v<F&, int32, int32>)
+            {
+                func(chunk_begin, chunk_end);
+            }
+            else
+            {
+                for (int32 i = chunk_begin; i < chunk_end; ++i)
+                {
+                    func(i);
+                }
+            }
+        }
+
+        Retire();
+    }
+
+private:
+    F& func;
+};
+
+// Around eight chunks per thread so that uneven iterations still balance out
+inline int32 GetParallelForChunkSize(int32 count, int32 worker_count)
+{
+    constexpr int32 balance = 8;
+    return std::max<int32>(1, count / (balance * worker_count));
+}
+
+// func is either void(int32 i) or void(int32 begin, int32 end)
+template <typename F>
+inline void ParallelFor(int32 begin, int32 end, F&& func, ThreadPool* thread_pool = ThreadPool::global_thread_pool.get())
 {
-    ParallelFor(
-        begin, end,
-        [&func](int32 begin, int32 end) {
+    static_assert(
+        std::is_invocable_v<F&, int32, int32> || std::is_invocable_v<F&, int32>,
+        "ParallelFor body must take an index or an index range"
+    );
+
+    if (begin == end)
+    {
+        return;
+    }
+
+    if (!thread_pool)
+    {
+        if constexpr (std::is_invocable_v<F&, int32, int32>)
+        {
+            func(begin, end);
+        }
+        else
+        {
             for (int32 i = begin; i < end; ++i)
             {
                 func(i);
             }
-        },
-        thread_pool
-    );
+        }
+
+        return;
+    }
+
+    // It's safe to allocate loop on the stack
+    // Because Execute() does not return until all work for the loop is done.
+    int32 chunk_size = GetParallelForChunkSize(end - begin, thread_pool->WorkerCount());
+    ParallelForLoop<std::remove_reference_t<F>> loop(begin, end, chunk_size, func);
+    loop.Execute(thread_pool);
 }
 
+// Tiles of at most max_tile_size in Hilbert curve order, the tiles are made smaller if there are too few
+// to keep all threads busy and the last ones are split into quadrants to shorten the tail of the loop
+std::vector<AABB2i> GetParallelFor2DTiles(const Point2i& extents, int32 max_tile_size, int32 worker_count);
+
+// Threads take one tile at a time, so the threads working at the same moment render neighboring tiles
+template <typename F>
 inline void ParallelFor2D(
-    const Point2i& extents,
-    std::function<void(AABB2i tile)> func,
-    int32 tile_size = 16,
-    ThreadPool* thread_pool = ThreadPool::global_thread_pool.get()
+    const Point2i& extents, F&& func, int32 tile_size = 16, ThreadPool* thread_pool = ThreadPool::global_thread_pool.get()
 )
 {
-    int32 num_tiles_x = (extents.x + tile_size - 1) / tile_size;
-    int32 num_tiles_y = (extents.y + tile_size - 1) / tile_size;
-    int32 tile_count = num_tiles_x * num_tiles_y;
-
-    ParallelFor(
-        0, tile_count,
-        [&](int32 i) {
-            Point2i tile(i % num_tiles_x, i / num_tiles_x);
-
-            int32 x0 = tile.x * tile_size;
-            int32 x1 = std::min(x0 + tile_size, extents.x);
-            int32 y0 = tile.y * tile_size;
-            int32 y1 = std::min(y0 + tile_size, extents.y);
-
-            func(AABB2i(Point2i(x0, y0), Point2i(x1, y1)));
-        },
-        thread_pool
-    );
+    if (extents.x <= 0 || extents.y <= 0)
+    {
+        return;
+    }
+
+    int32 worker_count = thread_pool ? thread_pool->WorkerCount() : 1;
+    std::vector<AABB2i> tiles = GetParallelFor2DTiles(extents, tile_size, worker_count);
+
+    if (!thread_pool)
+    {
+        for (const AABB2i& tile : tiles)
+        {
+            func(tile);
+        }
+
+        return;
+    }
+
+    auto body = [&](int32 i) { func(tiles[i]); };
+
+    ParallelForLoop<decltype(body)> loop(0, int32(tiles.size()), 1, body);
+    loop.Execute(thread_pool);
 }
 
 } // namespace bulbit
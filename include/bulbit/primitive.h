@@ -19,6 +19,8 @@ public:
     virtual AABB GetAABB() const override;
     virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
     virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+    virtual AABB GetClippedAABB(int32 axis, Float min, Float max) const override;
+    virtual uint64 GetGeometryHash() const override;
 
     const Shape* GetShape() const;
     const Material* GetMaterial() const;
@@ -42,6 +44,16 @@ inline AABB Primitive::GetAABB() const
     return shape->GetAABB();
 }
 
+inline AABB Primitive::GetClippedAABB(int32 axis, Float min, Float max) const
+{
+    return shape->GetClippedAABB(axis, min, max);
+}
+
+inline uint64 Primitive::GetGeometryHash() const
+{
+    return shape->GetGeometryHash();
+}
+
 inline bool Primitive::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
 {
     if (!shape->Intersect(isect, ray, t_min, t_max))
@@ -78,8 +90,32 @@ inline bool Primitive::Intersect(Intersection* isect, const Ray& ray, Float t_mi
 
 inline bool Primitive::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
 {
-    Intersection isect;
-    return Intersect(&isect, ray, t_min, t_max);
+    // Texture coordinates are needed only for alpha testing
+    const FloatTexture* alpha_texture = material ? material->GetAlphaTexture() : nullptr;
+    if (!alpha_texture)
+    {
+        return shape->IntersectAny(ray, t_min, t_max);
+    }
+
+    AnyHit hit;
+    if (!shape->IntersectAny(&hit, ray, t_min, t_max))
+    {
+        return false;
+    }
+
+    Float alpha = alpha_texture->Evaluate(hit.uv);
+    if (alpha < 1)
+    {
+        // Same stochastic test as Intersect so that both queries agree
+        Float p = alpha <= 0 ? 1 : HashFloat(ray, hit.point);
+        if (p > alpha)
+        {
+            Ray new_ray(hit.point, Normalize(ray.d));
+            return IntersectAny(new_ray, Ray::epsilon, t_max - hit.t);
+        }
+    }
+
+    return true;
 }
 
 inline const Shape* Primitive::GetShape() const
@@ -27,12 +27,20 @@ public:
     void WaitAndLogProgress() const;
     const Film& GetFilm() const;
 
+    // Latest image of the film published while rendering, null if there is none yet
+    std::shared_ptr<const Image3> GetSnapshot() const;
+
     const Camera* camera;
 
 protected:
+    void PublishSnapshot(Image3 image);
+
     Film film;
 
     std::unique_ptr<AsyncJob<bool>> job;
+
+    mutable std::mutex snapshot_mutex;
+    std::shared_ptr<const Image3> snapshot;
 };
 
 inline bool Rendering::Start(std::unique_ptr<AsyncJob<bool>> rendering)
@@ -69,4 +77,18 @@ inline const Film& Rendering::GetFilm() const
     return film;
 }
 
+inline std::shared_ptr<const Image3> Rendering::GetSnapshot() const
+{
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    return snapshot;
+}
+
+inline void Rendering::PublishSnapshot(Image3 image)
+{
+    auto new_snapshot = std::make_shared<const Image3>(std::move(image));
+
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    snapshot = std::move(new_snapshot);
+}
+
 } // namespace bulbit
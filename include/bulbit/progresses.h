@@ -33,6 +33,7 @@ private:
     friend class BiDirectionalRayIntegrator;
     friend class ReSTIRDIIntegrator;
     friend class ReSTIRPTIntegrator;
+    friend class WavefrontPathIntegrator;
 
     size_t works;
 
@@ -39,7 +39,7 @@ inline Ray Mul(const Transform& tf, const Ray& ray)
 
 inline Ray MulT(const Transform& tf, const Ray& ray)
 {
-    return Ray(MulT(tf, ray.o), tf.q.RotateInv(ray.d / tf.s));
+    return Ray(MulT(tf, ray.o), tf.q.RotateInv(ray.d) / tf.s);
 }
 
 } // namespace bulbit
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bvh.h"
 #include "scene.h"
 
 namespace bulbit
@@ -31,6 +32,10 @@ enum class SamplerType
 {
     independent,
     stratified,
+    sobol,   // Rounds samples per pixel up to a power of two
+    z_sobol, // Rounds samples per pixel up to a power of two
+    pmj02,
+    blue_noise,
 };
 
 struct SamplerInfo
@@ -83,6 +88,7 @@ enum class IntegratorType
     ao,
     albedo,
     debug,
+    wavefront_path,
     count,
 };
 
@@ -109,11 +115,52 @@ struct IntegratorInfo
     int32 M_light = 16;
     int32 M_bsdf = 1;
     bool include_visibility = false;
+
+    // Progressive rendering of the unidirectional integrators, disabled if pass_spp is 0
+    // Non-positive time limit and snapshot interval disable them
+    int32 pass_spp = 0;
+    Float time_limit = 0;
+    Float snapshot_interval = 0;
+
+    // Adaptive sampling of the unidirectional integrators, disabled if adaptive_threshold is 0
+    // The first pass is uniform, later passes spend the remaining samples where the relative error is above the threshold
+    Float adaptive_threshold = 0;
+
+    // Shade the camera ray hits of a tile grouped by material (unidirectional integrators)
+    bool sort_hits = false;
+};
+
+enum class AcceleratorType
+{
+    bvh,
+    bvh4,
+    bvh8,
+    bvh_q8,  // Binary BVH with 8 bit quantized bounds
+    bvh_q16, // Binary BVH with 16 bit quantized bounds
+};
+
+struct AcceleratorInfo
+{
+    AcceleratorType type = AcceleratorType::bvh;
+    BVHBuildMethod build_method = BVHBuildMethod::sah;
+
+    // Maximum ratio of duplicated references for spatial splits
+    Float split_budget = 0.3f;
+
+    // Built BVHs are stored here and memory mapped on later runs, caching is disabled if empty
+    std::string cache_directory = "";
+
+    // Store triangles in BVH leaf order for SIMD leaf intersection, costs 48 bytes per triangle
+    bool precompute_triangles = true;
+
+    // Cluster BVH nodes into page sized treelets instead of the depth first order
+    bool reorder_nodes = false;
 };
 
 struct RendererInfo
 {
     Scene scene;
+    AcceleratorInfo accelerator_info;
 
     CameraInfo camera_info;
     IntegratorInfo integrator_info;
@@ -2,6 +2,7 @@
 
 #include "allocator.h"
 #include "common.h"
+#include "dynamic_dispatcher.h"
 #include "math.h"
 
 namespace bulbit
@@ -9,12 +10,24 @@ namespace bulbit
 
 struct SamplerInfo;
 
-class Sampler
+using Samplers = TypePack<
+    class IndependentSampler,
+    class StratifiedSampler,
+    class SobolSampler,
+    class ZSobolSampler,
+    class PMJ02Sampler,
+    class BlueNoiseSampler>;
+
+// Samplers are used through virtual calls where the concrete type does not matter, hot loops can Dispatch once and
+// call the final sampler classes directly
+class Sampler : public DynamicDispatcher<Samplers>
 {
 public:
-    static Sampler* Create(Allocator& alloc, const SamplerInfo& sampler_info);
+    using Types = Samplers;
+
+    // Resolution of the film, used by samplers that distribute samples over the pixels
+    static Sampler* Create(Allocator& alloc, const SamplerInfo& sampler_info, Point2i resolution);
 
-    Sampler(int32 samples_per_pixel);
     virtual ~Sampler() = default;
 
     virtual void StartPixelSample(const Point2i& pixel, int32 sample_index);
@@ -22,17 +35,26 @@ public:
     virtual Float Next1D() = 0;
     virtual Point2 Next2D() = 0;
 
+    // Fills u with the next u.size() dimensions, same as taking them with Next2D and Next1D for an odd last one
+    virtual void NextND(std::span<Float> u) = 0;
+
     virtual Sampler* Clone(Allocator& alloc) const = 0;
 
     const int32 samples_per_pixel;
 
 protected:
+    Sampler(int32 type_index, int32 samples_per_pixel);
+
+    template <typename T>
+    static void NextNDFrom2D(T* sampler, std::span<Float> u);
+
     Point2i current_pixel;
     int32 current_sample_index;
 };
 
-inline Sampler::Sampler(int32 spp)
-    : samples_per_pixel{ spp }
+inline Sampler::Sampler(int32 type_index, int32 spp)
+    : DynamicDispatcher(type_index)
+    , samples_per_pixel{ spp }
 {
 }
 
@@ -42,4 +64,21 @@ inline void Sampler::StartPixelSample(const Point2i& pixel, int32 sample_index)
     current_sample_index = sample_index;
 }
 
+template <typename T>
+inline void Sampler::NextNDFrom2D(T* sampler, std::span<Float> u)
+{
+    size_t i = 0;
+    for (; i + 1 < u.size(); i += 2)
+    {
+        Point2 u2 = sampler->T::Next2D();
+        u[i] = u2.x;
+        u[i + 1] = u2.y;
+    }
+
+    if (i < u.size())
+    {
+        u[i] = sampler->T::Next1D();
+    }
+}
+
 } // namespace bulbit
@@ -7,7 +7,7 @@
 namespace bulbit
 {
 
-class IndependentSampler : public Sampler
+class IndependentSampler final : public Sampler
 {
 public:
     IndependentSampler(int32 samples_per_pixel, int32 seed = 0);
@@ -16,6 +16,7 @@ public:
 
     virtual Float Next1D() override;
     virtual Point2 Next2D() override;
+    virtual void NextND(std::span<Float> u) override;
 
     virtual Sampler* Clone(Allocator& alloc) const override;
 
@@ -24,7 +25,7 @@ private:
     RNG rng;
 };
 
-class StratifiedSampler : public Sampler
+class StratifiedSampler final : public Sampler
 {
 public:
     StratifiedSampler(int32 x_samples, int32 y_samples, bool jitter, int32 seed = 0);
@@ -33,6 +34,7 @@ public:
 
     virtual Float Next1D() override;
     virtual Point2 Next2D() override;
+    virtual void NextND(std::span<Float> u) override;
 
     virtual Sampler* Clone(Allocator& alloc) const override;
 
@@ -46,4 +48,106 @@ private:
     RNG rng;
 };
 
+// Sobol (0, 2)-sequence in each pixel, every dimension pair takes its own randomly permuted and Owen scrambled copy
+// samples_per_pixel should be a power of two
+class SobolSampler final : public Sampler
+{
+public:
+    SobolSampler(int32 samples_per_pixel, int32 seed = 0);
+
+    virtual void StartPixelSample(const Point2i& pixel, int32 sample_index) override;
+
+    virtual Float Next1D() override;
+    virtual Point2 Next2D() override;
+    virtual void NextND(std::span<Float> u) override;
+
+    virtual Sampler* Clone(Allocator& alloc) const override;
+
+private:
+    int32 seed;
+    int32 dimension;
+
+    // Hash of the pixel, seed and sample round, mixed with the dimension for the per dimension scrambling
+    uint64 pixel_hash;
+};
+
+// Sobol samples spread over the pixels in Morton order with randomly permuted base 4 digits, which makes the error
+// of neighboring pixels uncorrelated like blue noise (Ahmed and Wonka 2020)
+// samples_per_pixel should be a power of two
+class ZSobolSampler final : public Sampler
+{
+public:
+    ZSobolSampler(int32 samples_per_pixel, Point2i resolution, int32 seed = 0);
+
+    virtual void StartPixelSample(const Point2i& pixel, int32 sample_index) override;
+
+    virtual Float Next1D() override;
+    virtual Point2 Next2D() override;
+    virtual void NextND(std::span<Float> u) override;
+
+    virtual Sampler* Clone(Allocator& alloc) const override;
+
+private:
+    uint64 GetSampleIndex() const;
+
+    int32 seed;
+    int32 log2_samples_per_pixel;
+    int32 base4_digit_count;
+
+    int32 dimension;
+
+    // Samples past samples_per_pixel are taken from a differently scrambled copy of the sequence
+    int32 sample_round;
+    uint64 morton_index;
+};
+
+// Each pixel and dimension pair takes a randomly permuted prefix of one of the precomputed PMJ02 point sets
+class PMJ02Sampler final : public Sampler
+{
+public:
+    PMJ02Sampler(int32 samples_per_pixel, int32 seed = 0);
+
+    virtual void StartPixelSample(const Point2i& pixel, int32 sample_index) override;
+
+    virtual Float Next1D() override;
+    virtual Point2 Next2D() override;
+    virtual void NextND(std::span<Float> u) override;
+
+    virtual Sampler* Clone(Allocator& alloc) const override;
+
+private:
+    Point2 GetSample();
+
+    int32 seed;
+    int32 dimension;
+
+    // Hash of the pixel and seed, mixed with the dimension to choose the point set and permutation
+    uint64 pixel_hash;
+};
+
+// All pixels share one rank-1 lattice per dimension pair, randomly shifted by blue noise textures so the error
+// is distributed as blue noise in screen space (Georgiev and Fajardo 2016)
+// The shifts stay within the fundamental cell of the lattice, where the error changes smoothly with the shift
+class BlueNoiseSampler final : public Sampler
+{
+public:
+    BlueNoiseSampler(int32 samples_per_pixel, int32 seed = 0);
+
+    virtual void StartPixelSample(const Point2i& pixel, int32 sample_index) override;
+
+    virtual Float Next1D() override;
+    virtual Point2 Next2D() override;
+    virtual void NextND(std::span<Float> u) override;
+
+    virtual Sampler* Clone(Allocator& alloc) const override;
+
+private:
+    int32 GetLatticeIndex() const;
+    Float GetShift(int32 dimension_offset) const;
+
+    int32 seed;
+    int32 generator;
+    int32 dimension;
+};
+
 } // namespace bulbit
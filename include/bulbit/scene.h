@@ -11,6 +11,12 @@
 namespace bulbit
 {
 
+struct ObjectInstance
+{
+    int32 object;
+    Transform transform;
+};
+
 class Scene
 {
 public:
@@ -38,9 +44,18 @@ public:
     template <typename MaterialType, typename... Args>
     MaterialType* CreateMaterial(Args&&... args);
 
+    // Primitives created between BeginObject() and EndObject() form an object shared by its instances
+    int32 BeginObject();
+    void EndObject();
+    bool IsDefiningObject() const;
+    void CreateInstance(int32 object, const Transform& transform);
+
     const std::vector<Primitive*>& GetPrimitives() const;
     const std::vector<Light*>& GetLights() const;
 
+    const std::vector<std::vector<Primitive*>>& GetObjects() const;
+    const std::vector<ObjectInstance>& GetInstances() const;
+
 private:
     BufferResource buffer;
     PoolResource pool;
@@ -50,6 +65,10 @@ private:
     std::vector<Shape*> shapes;
     std::vector<Primitive*> primitives;
 
+    std::vector<std::vector<Primitive*>> objects;
+    std::vector<ObjectInstance> instances;
+    int32 current_object = -1;
+
     std::vector<Light*> lights;
 
     std::vector<Medium*> media;
@@ -82,6 +101,14 @@ inline Scene::~Scene()
         allocator.delete_object(p);
     }
 
+    for (std::vector<Primitive*>& object : objects)
+    {
+        for (Primitive* p : object)
+        {
+            allocator.delete_object(p);
+        }
+    }
+
     for (Light* l : lights)
     {
         allocator.delete_object(l);
@@ -118,7 +145,14 @@ template <typename... Args>
 inline Primitive* Scene::CreatePrimitive(Args&&... args)
 {
     Primitive* primitive = allocator.new_object<Primitive>(std::forward<Args>(args)...);
-    primitives.push_back(primitive);
+    if (current_object >= 0)
+    {
+        objects[current_object].push_back(primitive);
+    }
+    else
+    {
+        primitives.push_back(primitive);
+    }
     return primitive;
 }
 
@@ -152,6 +186,32 @@ inline MaterialType* Scene::CreateMaterial(Args&&... args)
     return material;
 }
 
+inline int32 Scene::BeginObject()
+{
+    BulbitAssert(current_object < 0);
+
+    current_object = int32(objects.size());
+    objects.emplace_back();
+    return current_object;
+}
+
+inline void Scene::EndObject()
+{
+    BulbitAssert(current_object >= 0);
+    current_object = -1;
+}
+
+inline bool Scene::IsDefiningObject() const
+{
+    return current_object >= 0;
+}
+
+inline void Scene::CreateInstance(int32 object, const Transform& transform)
+{
+    BulbitAssert(object >= 0 && object < int32(objects.size()));
+    instances.push_back({ object, transform });
+}
+
 inline const std::vector<Primitive*>& Scene::GetPrimitives() const
 {
     return primitives;
@@ -162,4 +222,14 @@ inline const std::vector<Light*>& Scene::GetLights() const
     return lights;
 }
 
+inline const std::vector<std::vector<Primitive*>>& Scene::GetObjects() const
+{
+    return objects;
+}
+
+inline const std::vector<ObjectInstance>& Scene::GetInstances() const
+{
+    return instances;
+}
+
 } // namespace bulbit
\ No newline at end of file
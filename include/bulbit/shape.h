@@ -14,9 +14,22 @@ struct ShapeSample
     Float pdf;
 };
 
+// Hit record of occlusion queries, holds only what the alpha test needs
+struct AnyHit
+{
+    Float t;
+    Point3 point;
+    Point2 uv;
+};
+
 class Shape : public Intersectable
 {
 public:
+    using Intersectable::IntersectAny;
+
+    // Occlusion query that also resolves the texture coordinates of the hit point, skips the shading frame
+    virtual bool IntersectAny(AnyHit* out_hit, const Ray& ray, Float t_min, Float t_max) const;
+
     // Sample random point on surface
     virtual ShapeSample Sample(Point2 u) const = 0;
     virtual Float PDF(const Intersection& isect) const = 0;
@@ -43,4 +56,18 @@ protected:
     }
 };
 
+inline bool Shape::IntersectAny(AnyHit* hit, const Ray& ray, Float t_min, Float t_max) const
+{
+    Intersection isect;
+    if (!Intersect(&isect, ray, t_min, t_max))
+    {
+        return false;
+    }
+
+    hit->t = isect.t;
+    hit->point = isect.point;
+    hit->uv = isect.uv;
+    return true;
+}
+
 } // namespace bulbit
@@ -17,6 +17,7 @@ public:
     virtual AABB GetAABB() const override;
     virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
     virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(AnyHit* out_hit, const Ray& ray, Float t_min, Float t_max) const override;
 
     virtual ShapeSample Sample(Point2 u) const override;
     virtual Float PDF(const Intersection& isect) const override;
@@ -39,6 +40,7 @@ public:
     virtual AABB GetAABB() const override;
     virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
     virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(AnyHit* out_hit, const Ray& ray, Float t_min, Float t_max) const override;
 
     virtual ShapeSample Sample(Point2 u) const override;
     virtual Float PDF(const Intersection& isect) const override;
@@ -49,8 +51,15 @@ public:
 
     virtual Float Area() const override;
 
+    virtual AABB GetClippedAABB(int32 axis, Float min, Float max) const override;
+    virtual uint64 GetGeometryHash() const override;
+
 private:
     friend class Scene;
+    friend class BVH;
+
+    // Fills the intersection record from the hit distance and the barycentric coordinates of the hit point
+    void SetIntersection(Intersection* isect, const Ray& ray, Float t, Float u, Float v) const;
 
     Vec3 GetNormal(Float u, Float v, Float w) const;
     Vec3 GetTangent(Float u, Float v, Float w) const;
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "floats.h"
+
+// Instruction sets available for the explicit SIMD code paths.
+// Every SIMD routine must keep a scalar fallback for the other targets and for double precision builds.
+
+#if defined(__AVX__)
+#define BULBIT_SIMD_AVX
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BULBIT_SIMD_SSE
+#endif
+
+#if defined(BULBIT_SIMD_SSE) || defined(BULBIT_SIMD_AVX)
+#include <immintrin.h>
+#endif
+
+// Explicit SIMD paths operate on single precision lanes only, so they are compiled out of double precision builds
+#if !defined(BULBIT_DOUBLE_PRECISION)
+#define BULBIT_SIMD_FLOAT
+#endif
+
+namespace bulbit
+{
+
+inline void Prefetch(const void* address)
+{
+#if defined(BULBIT_SIMD_SSE)
+    _mm_prefetch((const char*)address, _MM_HINT_T0);
+#else
+    BulbitNotUsed(address);
+#endif
+}
+
+} // namespace bulbit
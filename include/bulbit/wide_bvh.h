@@ -0,0 +1,252 @@
+#pragma once
+
+#include "bvh.h"
+#include "simd.h"
+
+namespace bulbit
+{
+
+// N-ary BVH collapsed from the binary SAH BVH.
+// Child bounds are stored as SoA so that all N boxes are tested against a ray in one step.
+template <int32 N>
+class WideBVH : public Intersectable
+{
+    static_assert(N == 4 || N == 8, "WideBVH supports 4 or 8 wide nodes");
+
+public:
+    WideBVH(
+        const std::vector<Intersectable*>& primitives,
+        BVHBuildMethod build_method = BVHBuildMethod::sah,
+        Float split_budget = 0.3f
+    );
+    WideBVH(
+        const std::vector<Primitive*>& primitives, BVHBuildMethod build_method = BVHBuildMethod::sah, Float split_budget = 0.3f
+    );
+    WideBVH(const BVH& bvh);
+
+    virtual AABB GetAABB() const override;
+    virtual bool Intersect(Intersection* out_isect, const Ray& ray, Float t_min, Float t_max) const override;
+    virtual bool IntersectAny(const Ray& ray, Float t_min, Float t_max) const override;
+
+    Float GetSAHCost() const;
+    int32 GetNodeCount() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    struct alignas(64) Node
+    {
+        void SetChild(int32 lane, const AABB& aabb, int32 offset, int32 count);
+        void SetEmpty(int32 lane);
+
+        uint32 TestRay(
+            const Point3& o, Float t_min, Float t_max, const Vec3& inv_dir, const int32 is_dir_neg[3], Float t_near[N]
+        ) const;
+
+        // [min|max][axis][lane]
+        Float bounds[2][3][N];
+
+        // Node index if count == 0, otherwise primitive offset of the leaf
+        int32 offset[N];
+        uint16 count[N];
+    };
+
+    int32 Collapse(const BVH& bvh, int32 binary_index);
+
+    template <typename T>
+    void RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const;
+
+    std::vector<Intersectable*> primitives;
+    std::vector<Node> nodes;
+    AABB aabb;
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
+
+template <int32 N>
+inline WideBVH<N>::WideBVH(const std::vector<Primitive*>& primitives, BVHBuildMethod build_method, Float split_budget)
+    : WideBVH(std::vector<Intersectable*>(primitives.begin(), primitives.end()), build_method, split_budget)
+{
+}
+
+template <int32 N>
+inline void WideBVH<N>::Node::SetChild(int32 lane, const AABB& child_aabb, int32 child_offset, int32 child_count)
+{
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        bounds[0][axis][lane] = child_aabb.min[axis];
+        bounds[1][axis][lane] = child_aabb.max[axis];
+    }
+
+    offset[lane] = child_offset;
+    count[lane] = uint16(child_count);
+}
+
+template <int32 N>
+inline void WideBVH<N>::Node::SetEmpty(int32 lane)
+{
+    // Inverted bounds never pass the slab test
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        bounds[0][axis][lane] = max_float;
+        bounds[1][axis][lane] = -max_float;
+    }
+
+    offset[lane] = -1;
+    count[lane] = 0;
+}
+
+template <int32 N>
+inline uint32 WideBVH<N>::Node::TestRay(
+    const Point3& o, Float t_min, Float t_max, const Vec3& inv_dir, const int32 is_dir_neg[3], Float t_near[N]
+) const
+{
+    const Float* near_x = bounds[is_dir_neg[0]][0];
+    const Float* near_y = bounds[is_dir_neg[1]][1];
+    const Float* near_z = bounds[is_dir_neg[2]][2];
+    const Float* far_x = bounds[1 - is_dir_neg[0]][0];
+    const Float* far_y = bounds[1 - is_dir_neg[1]][1];
+    const Float* far_z = bounds[1 - is_dir_neg[2]][2];
+
+    uint32 hit_mask = 0;
+
+#if defined(BULBIT_SIMD_AVX) && defined(BULBIT_SIMD_FLOAT)
+    if constexpr (N == 8)
+    {
+        const __m256 ox = _mm256_set1_ps(o.x), oy = _mm256_set1_ps(o.y), oz = _mm256_set1_ps(o.z);
+        const __m256 ix = _mm256_set1_ps(inv_dir.x), iy = _mm256_set1_ps(inv_dir.y), iz = _mm256_set1_ps(inv_dir.z);
+
+        __m256 t0 = _mm256_set1_ps(t_min);
+        __m256 t1 = _mm256_set1_ps(t_max);
+        t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_x), ox), ix), t0);
+        t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_y), oy), iy), t0);
+        t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_z), oz), iz), t0);
+        t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_x), ox), ix), t1);
+        t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_y), oy), iy), t1);
+        t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_z), oz), iz), t1);
+
+        _mm256_storeu_ps(t_near, t0);
+        return uint32(_mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ)));
+    }
+#endif
+
+#if defined(BULBIT_SIMD_SSE) && defined(BULBIT_SIMD_FLOAT)
+    {
+        const __m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+        const __m128 ix = _mm_set1_ps(inv_dir.x), iy = _mm_set1_ps(inv_dir.y), iz = _mm_set1_ps(inv_dir.z);
+
+        for (int32 i = 0; i < N; i += 4)
+        {
+            __m128 t0 = _mm_set1_ps(t_min);
+            __m128 t1 = _mm_set1_ps(t_max);
+            t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_x + i), ox), ix), t0);
+            t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_y + i), oy), iy), t0);
+            t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_z + i), oz), iz), t0);
+            t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_x + i), ox), ix), t1);
+            t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_y + i), oy), iy), t1);
+            t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_z + i), oz), iz), t1);
+
+            _mm_storeu_ps(t_near + i, t0);
+            hit_mask |= uint32(_mm_movemask_ps(_mm_cmple_ps(t0, t1))) << i;
+        }
+
+        return hit_mask;
+    }
+#else
+    for (int32 i = 0; i < N; ++i)
+    {
+        Float t0 = std::max(t_min, (near_x[i] - o.x) * inv_dir.x);
+        t0 = std::max(t0, (near_y[i] - o.y) * inv_dir.y);
+        t0 = std::max(t0, (near_z[i] - o.z) * inv_dir.z);
+
+        Float t1 = std::min(t_max, (far_x[i] - o.x) * inv_dir.x);
+        t1 = std::min(t1, (far_y[i] - o.y) * inv_dir.y);
+        t1 = std::min(t1, (far_z[i] - o.z) * inv_dir.z);
+
+        t_near[i] = t0;
+        hit_mask |= uint32(t0 <= t1) << i;
+    }
+
+    return hit_mask;
+#endif
+}
+
+template <int32 N>
+template <typename T>
+inline void WideBVH<N>::RayCast(const Ray& r, Float t_min, Float t_max, T* callback) const
+{
+    const Vec3 inv_dir(1 / r.d.x, 1 / r.d.y, 1 / r.d.z);
+    const int32 is_dir_neg[3] = { int32(inv_dir.x < 0), int32(inv_dir.y < 0), int32(inv_dir.z < 0) };
+
+    struct StackEntry
+    {
+        int32 offset;
+        int32 count;
+        Float t;
+    };
+
+    GrowableArray<StackEntry, 64> stack;
+    stack.Emplace(0, 0, t_min);
+
+    while (stack.Count() > 0)
+    {
+        StackEntry entry = stack.Pop();
+
+        // Ray has been shortened since this entry was pushed
+        if (entry.t > t_max)
+        {
+            continue;
+        }
+
+        if (entry.count > 0)
+        {
+            // Leaf node
+            for (int32 i = 0; i < entry.count; ++i)
+            {
+                Float t = callback->RayCastCallback(r, t_min, t_max, primitives[entry.offset + i]);
+                if (t <= t_min)
+                {
+                    return;
+                }
+                else
+                {
+                    // Shorten the ray
+                    t_max = t;
+                }
+            }
+
+            continue;
+        }
+
+        const Node& node = nodes[entry.offset];
+
+        alignas(32) Float t_near[N];
+        uint32 hit_mask = node.TestRay(r.o, t_min, t_max, inv_dir, is_dir_neg, t_near);
+
+        // Sort hit children far to near so that the nearest one is popped first
+        StackEntry hits[N];
+        int32 hit_count = 0;
+        while (hit_mask)
+        {
+            int32 lane = std::countr_zero(hit_mask);
+            hit_mask &= hit_mask - 1;
+
+            StackEntry hit{ node.offset[lane], node.count[lane], t_near[lane] };
+
+            int32 j = hit_count++;
+            while (j > 0 && hits[j - 1].t < hit.t)
+            {
+                hits[j] = hits[j - 1];
+                --j;
+            }
+            hits[j] = hit;
+        }
+
+        for (int32 i = 0; i < hit_count; ++i)
+        {
+            stack.Push(hits[i]);
+        }
+    }
+}
+
+} // namespace bulbit
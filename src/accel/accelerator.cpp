@@ -0,0 +1,207 @@
+#include "bulbit/accelerator.h"
+#include "bulbit/bvh.h"
+#include "bulbit/compressed_bvh.h"
+#include "bulbit/renderer_info.h"
+#include "bulbit/wide_bvh.h"
+
+namespace bulbit
+{
+
+static BVH* LoadOrBuildBVH(
+    Allocator& alloc, const AcceleratorInfo& ai, const std::vector<Intersectable*>& primitives, AcceleratorStats* stats
+)
+{
+    uint64 key = BVH::GetCacheKey(primitives, ai.build_method, ai.split_budget, ai.reorder_nodes);
+    std::filesystem::path filename = std::filesystem::path(ai.cache_directory) / std::format("{:016x}.bvh", key);
+
+    BVH* bvh = alloc.new_object<BVH>();
+    if (bvh->Load(filename, primitives, key))
+    {
+        if (stats)
+        {
+            ++stats->cache_hits;
+        }
+
+        return bvh;
+    }
+
+    alloc.delete_object(bvh);
+    bvh = alloc.new_object<BVH>(primitives, ai.build_method, ai.split_budget);
+    if (ai.reorder_nodes)
+    {
+        bvh->ReorderNodes();
+    }
+
+    if (stats)
+    {
+        ++stats->cache_misses;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(ai.cache_directory, error);
+    if (error || !bvh->Save(filename, primitives, key))
+    {
+        std::cerr << "Failed to write BVH cache: " << filename.string() << std::endl;
+    }
+
+    return bvh;
+}
+
+// Compressed BVHs reference the primitive list instead of copying it, so it is passed through in its original type
+template <typename T, typename P>
+static T* CreateBVH(Allocator& alloc, const AcceleratorInfo& ai, const std::vector<P*>& primitives, AcceleratorStats* stats)
+{
+    constexpr bool compressed = std::is_same_v<T, CompressedBVH8> || std::is_same_v<T, CompressedBVH16>;
+
+    T* bvh;
+    if (ai.cache_directory.empty() || primitives.empty())
+    {
+        bvh = alloc.new_object<T>(primitives, ai.build_method, ai.split_budget);
+
+        if constexpr (std::is_same_v<T, BVH>)
+        {
+            if (ai.reorder_nodes)
+            {
+                bvh->ReorderNodes();
+            }
+        }
+    }
+    else if constexpr (std::is_same_v<T, BVH>)
+    {
+        bvh = LoadOrBuildBVH(alloc, ai, std::vector<Intersectable*>(primitives.begin(), primitives.end()), stats);
+    }
+    else
+    {
+        // Wide and compressed nodes are converted from the cached binary tree
+        BVH* binary_bvh = LoadOrBuildBVH(alloc, ai, std::vector<Intersectable*>(primitives.begin(), primitives.end()), stats);
+        if constexpr (compressed)
+        {
+            bvh = alloc.new_object<T>(*binary_bvh, primitives);
+        }
+        else
+        {
+            bvh = alloc.new_object<T>(*binary_bvh);
+        }
+        alloc.delete_object(binary_bvh);
+    }
+
+    if constexpr (std::is_same_v<T, BVH>)
+    {
+        if (ai.precompute_triangles)
+        {
+            bvh->PrecomputeTriangles();
+        }
+    }
+
+    if (stats)
+    {
+        stats->node_count = bvh->GetNodeCount();
+        stats->sah_cost = bvh->GetSAHCost();
+        stats->memory_usage = bvh->GetMemoryUsage();
+    }
+
+    return bvh;
+}
+
+template <typename P>
+static Intersectable* CreateAccelerator(
+    Allocator& alloc, const AcceleratorInfo& ai, const std::vector<P*>& primitives, AcceleratorStats* stats
+)
+{
+    switch (ai.type)
+    {
+    case AcceleratorType::bvh:
+        return CreateBVH<BVH>(alloc, ai, primitives, stats);
+    case AcceleratorType::bvh4:
+        return CreateBVH<BVH4>(alloc, ai, primitives, stats);
+    case AcceleratorType::bvh8:
+        return CreateBVH<BVH8>(alloc, ai, primitives, stats);
+    case AcceleratorType::bvh_q8:
+        return CreateBVH<CompressedBVH8>(alloc, ai, primitives, stats);
+    case AcceleratorType::bvh_q16:
+        return CreateBVH<CompressedBVH16>(alloc, ai, primitives, stats);
+
+    default:
+        return nullptr;
+    }
+}
+
+Intersectable* CreateAccelerator(
+    Allocator& alloc, const AcceleratorInfo& ai, const std::vector<Intersectable*>& primitives, AcceleratorStats* stats
+)
+{
+    return CreateAccelerator<Intersectable>(alloc, ai, primitives, stats);
+}
+
+Intersectable* CreateAccelerator(
+    Allocator& alloc, const AcceleratorInfo& ai, const std::vector<Primitive*>& primitives, AcceleratorStats* stats
+)
+{
+    return CreateAccelerator<Primitive>(alloc, ai, primitives, stats);
+}
+
+Intersectable* CreateAccelerator(Allocator& alloc, const AcceleratorInfo& ai, const Scene& scene, AcceleratorStats* stats)
+{
+    if (scene.GetInstances().empty())
+    {
+        return CreateAccelerator(alloc, ai, scene.GetPrimitives(), stats);
+    }
+
+    return alloc.new_object<TwoLevelAccelerator>(alloc, ai, scene, stats);
+}
+
+TwoLevelAccelerator::TwoLevelAccelerator(Allocator& alloc, const AcceleratorInfo& ai, const Scene& scene, AcceleratorStats* stats)
+    : alloc{ alloc }
+{
+    AcceleratorStats object_stats;
+    size_t object_memory_usage = 0;
+
+    // Build bottom level structures once per object
+    for (const std::vector<Primitive*>& object : scene.GetObjects())
+    {
+        objects.push_back(object.empty() ? nullptr : CreateAccelerator(alloc, ai, object, &object_stats));
+        object_memory_usage += object_stats.memory_usage;
+        object_stats.memory_usage = 0;
+    }
+
+    const std::vector<ObjectInstance>& scene_instances = scene.GetInstances();
+    instances.reserve(scene_instances.size());
+
+    for (const ObjectInstance& instance : scene_instances)
+    {
+        if (objects[instance.object])
+        {
+            instances.emplace_back(objects[instance.object], instance.transform);
+        }
+    }
+
+    top_level_primitives.assign(scene.GetPrimitives().begin(), scene.GetPrimitives().end());
+    for (Instance& instance : instances)
+    {
+        top_level_primitives.push_back(&instance);
+    }
+
+    top_level = CreateAccelerator(alloc, ai, top_level_primitives, stats);
+
+    if (stats)
+    {
+        stats->cache_hits += object_stats.cache_hits;
+        stats->cache_misses += object_stats.cache_misses;
+        stats->memory_usage += object_memory_usage + instances.size() * sizeof(Instance);
+    }
+}
+
+TwoLevelAccelerator::~TwoLevelAccelerator()
+{
+    alloc.delete_object(top_level);
+
+    for (Intersectable* object : objects)
+    {
+        if (object)
+        {
+            alloc.delete_object(object);
+        }
+    }
+}
+
+} // namespace bulbit
@@ -1,11 +1,12 @@
 #include "bulbit/bvh.h"
 #include "bulbit/intersectable.h"
 #include "bulbit/parallel_for.h"
+#include "bulbit/shapes.h"
 
 namespace bulbit
 {
 
-BVH::BVH(const std::vector<Primitive*>& _primitives)
+BVH::BVH(const std::vector<Intersectable*>& _primitives, BVHBuildMethod build_method, Float split_budget)
     : primitives{ std::move(_primitives) }
 {
     size_t primitive_count = primitives.size();
@@ -15,7 +16,14 @@ BVH::BVH(const std::vector<Primitive*>& _primitives)
         bvh_primitives[i] = BVHPrimitive(i, primitives[i]->GetAABB());
     }
 
-    std::vector<Primitive*> ordered_prims(primitive_count);
+    // Spatial splits may reference a primitive from several leaves
+    int32 max_duplicates = 0;
+    if (build_method == BVHBuildMethod::sbvh)
+    {
+        max_duplicates = int32(primitive_count * std::max(split_budget, Float(0)));
+    }
+
+    std::vector<Intersectable*> ordered_prims(primitive_count + max_duplicates);
 
     std::atomic<int32> total_nodes(0);
     std::atomic<int32> ordered_prims_offset(0);
@@ -27,11 +35,46 @@ BVH::BVH(const std::vector<Primitive*>& _primitives)
         return Allocator(ptr);
     });
 
-    BuildNode* root = BuildRecursive(
-        thread_allocators, std::span<BVHPrimitive>(bvh_primitives), &total_nodes, &ordered_prims_offset, ordered_prims
-    );
+    BuildNode* root;
+    if (build_method == BVHBuildMethod::sbvh)
+    {
+        AABB root_bounds;
+        for (const BVHPrimitive& prim : bvh_primitives)
+        {
+            root_bounds = AABB::Union(root_bounds, prim.aabb);
+        }
+
+        // Spatial splits are only considered for nodes whose object split children overlap more than this
+        constexpr Float overlap_threshold = 1e-5f;
+        Float min_overlap_area = overlap_threshold * root_bounds.GetSurfaceArea();
+
+        std::atomic<int32> remaining_splits(max_duplicates);
+
+        root = BuildSpatialRecursive(
+            thread_allocators, bvh_primitives, min_overlap_area, &remaining_splits, &total_nodes, &ordered_prims_offset,
+            ordered_prims
+        );
+    }
+    else if (build_method == BVHBuildMethod::lbvh || build_method == BVHBuildMethod::ploc)
+    {
+        root = BuildLinear(
+            thread_allocators, std::span<BVHPrimitive>(bvh_primitives), build_method, &total_nodes, &ordered_prims_offset,
+            ordered_prims
+        );
+
+        BulbitAssert(size_t(ordered_prims_offset.load()) == primitive_count);
+    }
+    else
+    {
+        root = BuildRecursive(
+            thread_allocators, std::span<BVHPrimitive>(bvh_primitives), &total_nodes, &ordered_prims_offset, ordered_prims
+        );
+
+        BulbitAssert(size_t(ordered_prims_offset.load()) == primitive_count);
+    }
 
-    BulbitAssert(size_t(ordered_prims_offset.load()) == primitive_count);
+    BulbitAssert(size_t(ordered_prims_offset.load()) <= ordered_prims.size());
+    ordered_prims.resize(ordered_prims_offset.load());
 
     primitives.swap(ordered_prims);
 
@@ -39,18 +82,24 @@ BVH::BVH(const std::vector<Primitive*>& _primitives)
     bvh_primitives.resize(0);
     bvh_primitives.shrink_to_fit();
 
-    nodes = new LinearBVHNode[total_nodes];
-    int32 offset = 0;
+    node_count = total_nodes;
+    nodes = AllocateNodes(node_count);
+    int32 offset = 1;
 
     // Flatten out to linear BVH representation
-    FlattenBVH(root, &offset);
+    FlattenBVH(root, 0, &offset);
 
     BulbitAssert(offset == total_nodes);
+
+    SetupRefit();
 }
 
 BVH::~BVH()
 {
-    delete nodes;
+    if (!mapped_file)
+    {
+        FreeNodes(nodes);
+    }
 }
 
 BVH::BuildNode* BVH::BuildRecursive(
@@ -58,7 +107,7 @@ BVH::BuildNode* BVH::BuildRecursive(
     std::span<BVHPrimitive> primitive_span,
     std::atomic<int32>* total_nodes,
     std::atomic<int32>* ordered_prims_offset,
-    std::vector<Primitive*>& ordered_prims
+    std::vector<Intersectable*>& ordered_prims
 )
 {
     Allocator allocator = thread_allocators.Get();
@@ -270,12 +319,407 @@ BVH::BuildNode* BVH::BuildRecursive(
     return node;
 }
 
-int32 BVH::FlattenBVH(BuildNode* node, int32* offset)
+static bool IsEmpty(const AABB& aabb)
+{
+    return aabb.min.x > aabb.max.x || aabb.min.y > aabb.max.y || aabb.min.z > aabb.max.z;
+}
+
+// Spatial split BVH (SBVH)
+// https://www.nvidia.com/docs/IO/77714/sbvh.pdf
+BVH::BuildNode* BVH::BuildSpatialRecursive(
+    ThreadLocal<Allocator>& thread_allocators,
+    std::vector<BVHPrimitive>& references,
+    Float min_overlap_area,
+    std::atomic<int32>* split_budget,
+    std::atomic<int32>* total_nodes,
+    std::atomic<int32>* ordered_prims_offset,
+    std::vector<Intersectable*>& ordered_prims
+)
+{
+    Allocator allocator = thread_allocators.Get();
+    BuildNode* node = allocator.new_object<BuildNode>();
+
+    total_nodes->fetch_add(1);
+    int32 reference_count = int32(references.size());
+
+    AABB node_bounds, centroid_bounds;
+    for (const BVHPrimitive& ref : references)
+    {
+        node_bounds = AABB::Union(node_bounds, ref.aabb);
+        centroid_bounds = AABB::Union(centroid_bounds, ref.aabb.GetCenter());
+    }
+
+    auto init_leaf = [&]() {
+        int32 offset = ordered_prims_offset->fetch_add(reference_count);
+        for (int32 i = 0; i < reference_count; ++i)
+        {
+            ordered_prims[offset + i] = primitives[references[i].index];
+        }
+
+        node->InitLeaf(offset, reference_count, node_bounds);
+        return node;
+    };
+
+    const Float node_area = node_bounds.GetSurfaceArea();
+    if (node_area == 0 || reference_count == 1)
+    {
+        return init_leaf();
+    }
+
+    constexpr Float traverse_cost = 0.5f;
+
+    // Find the best object split over all axes
+    constexpr int32 bucket_size = 12;
+    constexpr int32 split_planes = bucket_size - 1;
+
+    Float object_cost = infinity;
+    int32 object_axis = -1;
+    int32 object_split_bucket = -1;
+    AABB object_left_bounds, object_right_bounds;
+
+    const Vec3 centroid_extents = centroid_bounds.GetExtents();
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        const Float extent = centroid_extents[axis];
+        if (extent <= 0)
+        {
+            continue;
+        }
+
+        struct BVHSplitBucket
+        {
+            int32 count = 0;
+            AABB bounds;
+        };
+
+        BVHSplitBucket buckets[bucket_size];
+        for (const BVHPrimitive& ref : references)
+        {
+            int32 bucket_index = int32(bucket_size * (ref.aabb.GetCenter() - centroid_bounds.min)[axis] / extent);
+            bucket_index = std::min(bucket_index, bucket_size - 1);
+
+            buckets[bucket_index].count++;
+            buckets[bucket_index].bounds = AABB::Union(buckets[bucket_index].bounds, ref.aabb);
+        }
+
+        AABB left_bounds[split_planes], right_bounds[split_planes];
+        int32 left_count[split_planes], right_count[split_planes];
+
+        AABB left_bound, right_bound;
+        int32 left_sum = 0, right_sum = 0;
+        for (int32 i = 0; i < split_planes; ++i)
+        {
+            left_sum += buckets[i].count;
+            left_bound = AABB::Union(left_bound, buckets[i].bounds);
+            left_count[i] = left_sum;
+            left_bounds[i] = left_bound;
+
+            right_sum += buckets[split_planes - i].count;
+            right_bound = AABB::Union(right_bound, buckets[split_planes - i].bounds);
+            right_count[split_planes - 1 - i] = right_sum;
+            right_bounds[split_planes - 1 - i] = right_bound;
+        }
+
+        for (int32 i = 0; i < split_planes; ++i)
+        {
+            if (left_count[i] == 0 || right_count[i] == 0)
+            {
+                continue;
+            }
+
+            Float cost = left_count[i] * left_bounds[i].GetSurfaceArea() + right_count[i] * right_bounds[i].GetSurfaceArea();
+            if (cost < object_cost)
+            {
+                object_cost = cost;
+                object_axis = axis;
+                object_split_bucket = i;
+                object_left_bounds = left_bounds[i];
+                object_right_bounds = right_bounds[i];
+            }
+        }
+    }
+
+    // Try spatial splits only if the object split children overlap significantly
+    bool try_spatial_split = split_budget->load() > 0;
+    if (try_spatial_split && object_axis >= 0)
+    {
+        AABB overlap = AABB::Intersection(object_left_bounds, object_right_bounds);
+        try_spatial_split = !IsEmpty(overlap) && overlap.GetSurfaceArea() > min_overlap_area;
+    }
+
+    // Find the best spatial split over all axes
+    constexpr int32 spatial_bin_size = 16;
+
+    Float spatial_cost = infinity;
+    int32 spatial_axis = -1;
+    Float spatial_split_pos = 0;
+    AABB spatial_left_bounds, spatial_right_bounds;
+    int32 spatial_left_count = 0, spatial_right_count = 0;
+
+    const Vec3 node_extents = node_bounds.GetExtents();
+    for (int32 axis = 0; try_spatial_split && axis < 3; ++axis)
+    {
+        const Float extent = node_extents[axis];
+        if (extent <= 0)
+        {
+            continue;
+        }
+
+        struct SpatialBin
+        {
+            int32 enter = 0, exit = 0;
+            AABB bounds;
+        };
+
+        SpatialBin bins[spatial_bin_size];
+
+        const Float origin = node_bounds.min[axis];
+        const Float bin_width = extent / spatial_bin_size;
+
+        for (const BVHPrimitive& ref : references)
+        {
+            int32 first = int32((ref.aabb.min[axis] - origin) / bin_width);
+            int32 last = int32((ref.aabb.max[axis] - origin) / bin_width);
+            first = Clamp(first, 0, spatial_bin_size - 1);
+            last = Clamp(last, first, spatial_bin_size - 1);
+
+            const Intersectable* primitive = primitives[ref.index];
+            for (int32 i = first; i <= last; ++i)
+            {
+                Float bin_min = origin + i * bin_width;
+                Float bin_max = i == spatial_bin_size - 1 ? node_bounds.max[axis] : origin + (i + 1) * bin_width;
+
+                AABB clipped = AABB::Intersection(primitive->GetClippedAABB(axis, bin_min, bin_max), ref.aabb);
+                bins[i].bounds = AABB::Union(bins[i].bounds, clipped);
+            }
+
+            bins[first].enter++;
+            bins[last].exit++;
+        }
+
+        constexpr int32 spatial_split_planes = spatial_bin_size - 1;
+
+        AABB left_bounds[spatial_split_planes], right_bounds[spatial_split_planes];
+        int32 left_count[spatial_split_planes], right_count[spatial_split_planes];
+
+        AABB left_bound, right_bound;
+        int32 left_sum = 0, right_sum = 0;
+        for (int32 i = 0; i < spatial_split_planes; ++i)
+        {
+            left_sum += bins[i].enter;
+            left_bound = AABB::Union(left_bound, bins[i].bounds);
+            left_count[i] = left_sum;
+            left_bounds[i] = left_bound;
+
+            right_sum += bins[spatial_split_planes - i].exit;
+            right_bound = AABB::Union(right_bound, bins[spatial_split_planes - i].bounds);
+            right_count[spatial_split_planes - 1 - i] = right_sum;
+            right_bounds[spatial_split_planes - 1 - i] = right_bound;
+        }
+
+        for (int32 i = 0; i < spatial_split_planes; ++i)
+        {
+            if (left_count[i] == 0 || right_count[i] == 0)
+            {
+                continue;
+            }
+
+            Float cost = left_count[i] * left_bounds[i].GetSurfaceArea() + right_count[i] * right_bounds[i].GetSurfaceArea();
+            if (cost < spatial_cost)
+            {
+                spatial_cost = cost;
+                spatial_axis = axis;
+                spatial_split_pos = origin + (i + 1) * bin_width;
+                spatial_left_bounds = left_bounds[i];
+                spatial_right_bounds = right_bounds[i];
+                spatial_left_count = left_count[i];
+                spatial_right_count = right_count[i];
+            }
+        }
+    }
+
+    Float min_cost = traverse_cost + std::min(object_cost, spatial_cost) / node_area;
+    const Float direct_leaf_cost = Float(reference_count);
+
+    if (object_axis < 0 && spatial_axis < 0)
+    {
+        // Every reference shares the same centroid
+        if (reference_count <= 2)
+        {
+            return init_leaf();
+        }
+    }
+    else if (min_cost >= direct_leaf_cost)
+    {
+        return init_leaf();
+    }
+
+    std::vector<BVHPrimitive> left, right;
+    int32 axis = -1;
+
+    if (spatial_cost < object_cost)
+    {
+        axis = spatial_axis;
+
+        AABB left_bounds = spatial_left_bounds, right_bounds = spatial_right_bounds;
+        int32 left_count = spatial_left_count, right_count = spatial_right_count;
+
+        for (const BVHPrimitive& ref : references)
+        {
+            if (ref.aabb.max[axis] <= spatial_split_pos)
+            {
+                left.push_back(ref);
+                continue;
+            }
+            if (ref.aabb.min[axis] >= spatial_split_pos)
+            {
+                right.push_back(ref);
+                continue;
+            }
+
+            // Reference unsplitting
+            AABB left_union = AABB::Union(left_bounds, ref.aabb);
+            AABB right_union = AABB::Union(right_bounds, ref.aabb);
+
+            Float left_area = left_bounds.GetSurfaceArea();
+            Float right_area = right_bounds.GetSurfaceArea();
+
+            Float split_cost = left_area * left_count + right_area * right_count;
+            Float unsplit_left_cost = left_union.GetSurfaceArea() * left_count + right_area * (right_count - 1);
+            Float unsplit_right_cost = left_area * (left_count - 1) + right_union.GetSurfaceArea() * right_count;
+
+            if (split_cost < std::min(unsplit_left_cost, unsplit_right_cost) && split_budget->fetch_sub(1) > 0)
+            {
+                // Duplicate the reference with bounds clipped to each side
+                const Intersectable* primitive = primitives[ref.index];
+                AABB left_clipped = primitive->GetClippedAABB(axis, ref.aabb.min[axis], spatial_split_pos);
+                AABB right_clipped = primitive->GetClippedAABB(axis, spatial_split_pos, ref.aabb.max[axis]);
+                left_clipped = AABB::Intersection(left_clipped, ref.aabb);
+                right_clipped = AABB::Intersection(right_clipped, ref.aabb);
+
+                if (!IsEmpty(left_clipped))
+                {
+                    left.emplace_back(ref.index, left_clipped);
+                }
+                if (!IsEmpty(right_clipped))
+                {
+                    right.emplace_back(ref.index, right_clipped);
+                }
+            }
+            else if (unsplit_left_cost <= unsplit_right_cost)
+            {
+                left.push_back(ref);
+                left_bounds = left_union;
+                --right_count;
+            }
+            else
+            {
+                right.push_back(ref);
+                right_bounds = right_union;
+                --left_count;
+            }
+        }
+
+        if (left.empty() || right.empty())
+        {
+            // Degenerated spatial split, rollback to the object split
+            left.clear();
+            right.clear();
+            axis = -1;
+        }
+    }
+
+    if (axis < 0 && object_axis >= 0)
+    {
+        axis = object_axis;
+
+        const Float extent = centroid_extents[axis];
+        for (const BVHPrimitive& ref : references)
+        {
+            int32 bucket_index = int32(bucket_size * (ref.aabb.GetCenter() - centroid_bounds.min)[axis] / extent);
+            bucket_index = std::min(bucket_index, bucket_size - 1);
+
+            if (bucket_index <= object_split_bucket)
+            {
+                left.push_back(ref);
+            }
+            else
+            {
+                right.push_back(ref);
+            }
+        }
+    }
+
+    if (left.empty() || right.empty())
+    {
+        // Split in half along the longest axis
+        left.clear();
+        right.clear();
+
+        axis = 0;
+        if (node_extents.y > node_extents.x)
+        {
+            axis = 1;
+        }
+        if (node_extents.z > node_extents[axis])
+        {
+            axis = 2;
+        }
+
+        int32 mid = reference_count / 2;
+        std::nth_element(
+            references.begin(), references.begin() + mid, references.end(),
+            [axis](const BVHPrimitive& a, const BVHPrimitive& b) { return a.aabb.GetCenter()[axis] < b.aabb.GetCenter()[axis]; }
+        );
+
+        left.assign(references.begin(), references.begin() + mid);
+        right.assign(references.begin() + mid, references.end());
+    }
+
+    // Release references of this node before going down
+    references.clear();
+    references.shrink_to_fit();
+
+    BuildNode* child1;
+    BuildNode* child2;
+
+    if (reference_count > 64 * 1024)
+    {
+        ParallelFor(0, 2, [&](int i) {
+            if (i == 0)
+            {
+                child1 = BuildSpatialRecursive(
+                    thread_allocators, left, min_overlap_area, split_budget, total_nodes, ordered_prims_offset, ordered_prims
+                );
+            }
+            else
+            {
+                child2 = BuildSpatialRecursive(
+                    thread_allocators, right, min_overlap_area, split_budget, total_nodes, ordered_prims_offset, ordered_prims
+                );
+            }
+        });
+    }
+    else
+    {
+        child1 = BuildSpatialRecursive(
+            thread_allocators, left, min_overlap_area, split_budget, total_nodes, ordered_prims_offset, ordered_prims
+        );
+        child2 = BuildSpatialRecursive(
+            thread_allocators, right, min_overlap_area, split_budget, total_nodes, ordered_prims_offset, ordered_prims
+        );
+    }
+
+    node->InitInternal(axis, child1, child2);
+
+    return node;
+}
+
+void BVH::FlattenBVH(BuildNode* node, int32 index, int32* offset)
 {
-    LinearBVHNode* linear_node = &nodes[*offset];
+    LinearBVHNode* linear_node = &nodes[index];
     linear_node->aabb = node->aabb;
 
-    int32 node_offset = (*offset)++;
     if (node->count > 0)
     {
         // Leaf node
@@ -288,12 +732,15 @@ int32 BVH::FlattenBVH(BuildNode* node, int32* offset)
         linear_node->axis = uint8(node->axis);
         linear_node->primitive_count = 0;
 
+        // Reserve the sibling pair, then lay out the subtrees depth first
+        int32 child_offset = *offset;
+        *offset += 2;
+        linear_node->child_offset = child_offset;
+
         // Order matters!
-        FlattenBVH(node->child1, offset);
-        linear_node->child2_offset = FlattenBVH(node->child2, offset);
+        FlattenBVH(node->child1, child_offset, offset);
+        FlattenBVH(node->child2, child_offset + 1, offset);
     }
-
-    return node_offset;
 }
 
 bool BVH::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
@@ -304,6 +751,10 @@ bool BVH::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_ma
         bool hit_closest;
         Float t;
 
+        // Intersection record of a precomputed triangle hit is filled once the traversal is over
+        int32 closest_triangle;
+        Float u, v;
+
         Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, const Intersectable* object)
         {
             Intersection isect;
@@ -315,19 +766,44 @@ bool BVH::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_ma
                 hit_closest = true;
                 t = isect.t;
                 *closest = isect;
+                closest_triangle = -1;
             }
 
             // Keep traverse with smaller bounds
             return t;
         }
+
+        Float RayCastTriangleCallback(Float t_min, int32 index, Float t_hit, Float u_hit, Float v_hit)
+        {
+            BulbitNotUsed(t_min);
+            BulbitAssert(t_hit <= t);
+
+            hit_closest = true;
+            t = t_hit;
+            closest_triangle = index;
+            u = u_hit;
+            v = v_hit;
+
+            return t;
+        }
     } callback;
 
     callback.closest = isect;
     callback.hit_closest = false;
     callback.t = t_max;
+    callback.closest_triangle = -1;
 
     RayCast(ray, t_min, t_max, &callback);
 
+    if (callback.closest_triangle >= 0)
+    {
+        const Primitive* primitive = (const Primitive*)primitives[callback.closest_triangle];
+        const Triangle* triangle = (const Triangle*)primitive->GetShape();
+
+        triangle->SetIntersection(isect, ray, callback.t, callback.u, callback.v);
+        isect->primitive = primitive;
+    }
+
     return callback.hit_closest;
 }
 
@@ -351,6 +827,17 @@ bool BVH::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
 
             return t_max;
         }
+
+        Float RayCastTriangleCallback(Float t_min, int32 index, Float t_hit, Float u, Float v)
+        {
+            BulbitNotUsed(index);
+            BulbitNotUsed(t_hit);
+            BulbitNotUsed(u);
+            BulbitNotUsed(v);
+
+            hit_any = true;
+            return t_min;
+        }
     } callback;
 
     callback.hit_any = false;
@@ -365,4 +852,36 @@ AABB BVH::GetAABB() const
     return nodes[0].aabb;
 }
 
+Float BVH::GetSAHCost() const
+{
+    constexpr Float traverse_cost = 0.5f;
+
+    Float cost = 0;
+    for (int32 i = 0; i < node_count; ++i)
+    {
+        const LinearBVHNode& node = nodes[i];
+        if (node.primitive_count > 0)
+        {
+            cost += node.primitive_count * node.aabb.GetSurfaceArea();
+        }
+        else
+        {
+            cost += traverse_cost * node.aabb.GetSurfaceArea();
+        }
+    }
+
+    return cost / nodes[0].aabb.GetSurfaceArea();
+}
+
+int32 BVH::GetNodeCount() const
+{
+    return node_count;
+}
+
+size_t BVH::GetMemoryUsage() const
+{
+    return sizeof(BVH) + node_count * sizeof(LinearBVHNode) + primitives.size() * sizeof(Intersectable*) +
+           triangles.GetMemoryUsage();
+}
+
 } // namespace bulbit
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "bulbit/bvh.h"
+#include "bulbit/hash_map.h"
+#include "bulbit/parallel_for.h"
+
+#include <fstream>
+
+namespace bulbit
+{
+
+// Bump whenever the node layout or the builders change
+constexpr uint32 bvh_cache_version = 2;
+
+struct alignas(64) BVHCacheHeader
+{
+    char magic[4];
+    uint32 version;
+    uint32 float_size;
+    uint32 node_size;
+    uint64 key;
+
+    int32 primitive_count;
+    int32 node_count;
+
+    // Nonzero if the nodes were reordered into treelets
+    uint32 reordered;
+
+    // Number of leaf references, exceeds the primitive count if spatial splits duplicated some
+    int32 reference_count;
+};
+
+static constexpr char bvh_cache_magic[4] = { 'B', 'V', 'H', 'C' };
+
+uint64 BVH::GetCacheKey(
+    const std::vector<Intersectable*>& primitives, BVHBuildMethod build_method, Float split_budget, bool reorder_nodes
+)
+{
+    // Fixed chunk size so that the key does not depend on the thread count
+    constexpr int32 chunk_size = 4096;
+
+    int32 primitive_count = int32(primitives.size());
+    int32 chunk_count = (primitive_count + chunk_size - 1) / chunk_size;
+
+    std::vector<uint64> chunk_hashes(chunk_count);
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32 begin = chunk * chunk_size;
+        int32 end = std::min(begin + chunk_size, primitive_count);
+
+        uint64 hash = 0;
+        for (int32 i = begin; i < end; ++i)
+        {
+            hash = MixBits(hash ^ primitives[i]->GetGeometryHash());
+        }
+
+        chunk_hashes[chunk] = hash;
+    });
+
+    if (build_method != BVHBuildMethod::sbvh)
+    {
+        split_budget = 0;
+    }
+
+    uint64 settings =
+        Hash(bvh_cache_version, uint32(sizeof(Float)), build_method, split_budget, reorder_nodes, primitive_count);
+    return HashBuffer(chunk_hashes.data(), chunk_hashes.size() * sizeof(uint64), settings);
+}
+
+bool BVH::Load(const std::filesystem::path& filename, const std::vector<Intersectable*>& _primitives, uint64 key)
+{
+    auto file = std::make_unique<MappedFile>();
+    if (!file->Open(filename) || file->GetSize() < sizeof(BVHCacheHeader))
+    {
+        return false;
+    }
+
+    const uint8* data = (const uint8*)file->GetData();
+
+    BVHCacheHeader header;
+    std::memcpy(&header, data, sizeof(BVHCacheHeader));
+
+    if (std::memcmp(header.magic, bvh_cache_magic, sizeof(bvh_cache_magic)) != 0 || header.version != bvh_cache_version ||
+        header.float_size != sizeof(Float) || header.node_size != sizeof(LinearBVHNode) || header.key != key ||
+        header.primitive_count != int32(_primitives.size()) || header.node_count <= 0 || header.reference_count < 0)
+    {
+        return false;
+    }
+
+    // One node of padding keeps the sibling pairs aligned to cache lines, see AllocateNodes
+    size_t nodes_offset = sizeof(BVHCacheHeader) + sizeof(LinearBVHNode);
+    size_t nodes_size = size_t(header.node_count) * sizeof(LinearBVHNode);
+    size_t indices_size = size_t(header.reference_count) * sizeof(int32);
+    if (file->GetSize() != nodes_offset + nodes_size + indices_size)
+    {
+        return false;
+    }
+
+    std::vector<Intersectable*> ordered_prims(header.reference_count);
+
+    const int32* indices = (const int32*)(data + nodes_offset + nodes_size);
+    for (int32 i = 0; i < header.reference_count; ++i)
+    {
+        if (indices[i] < 0 || indices[i] >= header.primitive_count)
+        {
+            return false;
+        }
+
+        ordered_prims[i] = _primitives[indices[i]];
+    }
+
+    if (!mapped_file)
+    {
+        FreeNodes(nodes);
+    }
+
+    // Nodes are used in place, the header and the padding keep them aligned within the page aligned mapping
+    nodes = (LinearBVHNode*)(data + nodes_offset);
+    node_count = header.node_count;
+    reordered = header.reordered != 0;
+    primitives = std::move(ordered_prims);
+    mapped_file = std::move(file);
+    triangles = {};
+
+    SetupRefit();
+
+    return true;
+}
+
+bool BVH::Save(const std::filesystem::path& filename, const std::vector<Intersectable*>& _primitives, uint64 key) const
+{
+    HashMap<const Intersectable*, int32> primitive_indices;
+    for (int32 i = 0; i < int32(_primitives.size()); ++i)
+    {
+        primitive_indices.Insert(_primitives[i], i);
+    }
+
+    std::vector<int32> indices(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        if (!primitive_indices.Contains(primitives[i]))
+        {
+            return false;
+        }
+
+        indices[i] = primitive_indices.At(primitives[i]);
+    }
+
+    BVHCacheHeader header{};
+    std::memcpy(header.magic, bvh_cache_magic, sizeof(bvh_cache_magic));
+    header.version = bvh_cache_version;
+    header.float_size = sizeof(Float);
+    header.node_size = sizeof(LinearBVHNode);
+    header.key = key;
+    header.primitive_count = int32(_primitives.size());
+    header.node_count = node_count;
+    header.reference_count = int32(indices.size());
+    header.reordered = reordered;
+
+    // Write to a temporary file first so that other processes never map a partially written cache
+    std::filesystem::path temp_filename = filename;
+    temp_filename += ".tmp";
+
+    {
+        std::ofstream out(temp_filename, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+
+        const LinearBVHNode padding{};
+
+        out.write((const char*)&header, sizeof(BVHCacheHeader));
+        out.write((const char*)&padding, sizeof(LinearBVHNode));
+        out.write((const char*)nodes, std::streamsize(node_count) * sizeof(LinearBVHNode));
+        out.write((const char*)indices.data(), std::streamsize(indices.size()) * sizeof(int32));
+
+        if (!out)
+        {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_filename, filename, error);
+    if (error)
+    {
+        std::filesystem::remove(temp_filename, error);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace bulbit
@@ -0,0 +1,374 @@
+#include "bulbit/bvh.h"
+#include "bulbit/shapes.h"
+#include "bulbit/simd.h"
+
+namespace bulbit
+{
+
+BVH::RayPacket::RayPacket(std::span<const Ray> rays, Float _t_min, Float _t_max)
+    : size{ int32(rays.size()) }
+    , t_min{ _t_min }
+{
+    BulbitAssert(size <= max_size);
+
+    for (int32 i = 0; i < size; ++i)
+    {
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            o[axis][i] = rays[i].o[axis];
+            inv_dir[axis][i] = 1 / rays[i].d[axis];
+        }
+
+        t_max[i] = _t_max;
+    }
+
+    // Padding lanes never pass the slab test
+    for (int32 i = size; i < max_size; ++i)
+    {
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            o[axis][i] = 0;
+            inv_dir[axis][i] = 0;
+        }
+
+        t_max[i] = -infinity;
+    }
+}
+
+uint64 BVH::RayPacket::TestAABB(const AABB& aabb, uint64 active_mask) const
+{
+    uint64 hit_mask = 0;
+
+#if defined(BULBIT_SIMD_AVX) && defined(BULBIT_SIMD_FLOAT)
+    {
+        const __m256 min_x = _mm256_set1_ps(aabb.min.x), min_y = _mm256_set1_ps(aabb.min.y), min_z = _mm256_set1_ps(aabb.min.z);
+        const __m256 max_x = _mm256_set1_ps(aabb.max.x), max_y = _mm256_set1_ps(aabb.max.y), max_z = _mm256_set1_ps(aabb.max.z);
+
+        for (int32 i = 0; i < size; i += 8)
+        {
+            // Skip groups without active rays
+            if (((active_mask >> i) & 0xff) == 0)
+            {
+                continue;
+            }
+
+            const __m256 ox = _mm256_load_ps(o[0] + i), oy = _mm256_load_ps(o[1] + i), oz = _mm256_load_ps(o[2] + i);
+            const __m256 ix = _mm256_load_ps(inv_dir[0] + i), iy = _mm256_load_ps(inv_dir[1] + i),
+                         iz = _mm256_load_ps(inv_dir[2] + i);
+
+            const __m256 t0x = _mm256_mul_ps(_mm256_sub_ps(min_x, ox), ix), t1x = _mm256_mul_ps(_mm256_sub_ps(max_x, ox), ix);
+            const __m256 t0y = _mm256_mul_ps(_mm256_sub_ps(min_y, oy), iy), t1y = _mm256_mul_ps(_mm256_sub_ps(max_y, oy), iy);
+            const __m256 t0z = _mm256_mul_ps(_mm256_sub_ps(min_z, oz), iz), t1z = _mm256_mul_ps(_mm256_sub_ps(max_z, oz), iz);
+
+            // NaN slabs are ignored since min/max return the second operand
+            __m256 t_near = _mm256_set1_ps(t_min);
+            __m256 t_far = _mm256_load_ps(t_max + i);
+            t_near = _mm256_max_ps(_mm256_min_ps(t0x, t1x), t_near);
+            t_near = _mm256_max_ps(_mm256_min_ps(t0y, t1y), t_near);
+            t_near = _mm256_max_ps(_mm256_min_ps(t0z, t1z), t_near);
+            t_far = _mm256_min_ps(_mm256_max_ps(t0x, t1x), t_far);
+            t_far = _mm256_min_ps(_mm256_max_ps(t0y, t1y), t_far);
+            t_far = _mm256_min_ps(_mm256_max_ps(t0z, t1z), t_far);
+
+            hit_mask |= uint64(_mm256_movemask_ps(_mm256_cmp_ps(t_near, t_far, _CMP_LE_OQ))) << i;
+        }
+
+        return hit_mask & active_mask;
+    }
+#elif defined(BULBIT_SIMD_SSE) && defined(BULBIT_SIMD_FLOAT)
+    {
+        const __m128 min_x = _mm_set1_ps(aabb.min.x), min_y = _mm_set1_ps(aabb.min.y), min_z = _mm_set1_ps(aabb.min.z);
+        const __m128 max_x = _mm_set1_ps(aabb.max.x), max_y = _mm_set1_ps(aabb.max.y), max_z = _mm_set1_ps(aabb.max.z);
+
+        for (int32 i = 0; i < size; i += 4)
+        {
+            if (((active_mask >> i) & 0xf) == 0)
+            {
+                continue;
+            }
+
+            const __m128 ox = _mm_load_ps(o[0] + i), oy = _mm_load_ps(o[1] + i), oz = _mm_load_ps(o[2] + i);
+            const __m128 ix = _mm_load_ps(inv_dir[0] + i), iy = _mm_load_ps(inv_dir[1] + i), iz = _mm_load_ps(inv_dir[2] + i);
+
+            const __m128 t0x = _mm_mul_ps(_mm_sub_ps(min_x, ox), ix), t1x = _mm_mul_ps(_mm_sub_ps(max_x, ox), ix);
+            const __m128 t0y = _mm_mul_ps(_mm_sub_ps(min_y, oy), iy), t1y = _mm_mul_ps(_mm_sub_ps(max_y, oy), iy);
+            const __m128 t0z = _mm_mul_ps(_mm_sub_ps(min_z, oz), iz), t1z = _mm_mul_ps(_mm_sub_ps(max_z, oz), iz);
+
+            __m128 t_near = _mm_set1_ps(t_min);
+            __m128 t_far = _mm_load_ps(t_max + i);
+            t_near = _mm_max_ps(_mm_min_ps(t0x, t1x), t_near);
+            t_near = _mm_max_ps(_mm_min_ps(t0y, t1y), t_near);
+            t_near = _mm_max_ps(_mm_min_ps(t0z, t1z), t_near);
+            t_far = _mm_min_ps(_mm_max_ps(t0x, t1x), t_far);
+            t_far = _mm_min_ps(_mm_max_ps(t0y, t1y), t_far);
+            t_far = _mm_min_ps(_mm_max_ps(t0z, t1z), t_far);
+
+            hit_mask |= uint64(_mm_movemask_ps(_mm_cmple_ps(t_near, t_far))) << i;
+        }
+
+        return hit_mask & active_mask;
+    }
+#else
+    for (int32 i = 0; i < size; ++i)
+    {
+        if ((active_mask & (uint64(1) << i)) == 0)
+        {
+            continue;
+        }
+
+        Float t_near = t_min;
+        Float t_far = t_max[i];
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            Float t0 = (aabb.min[axis] - o[axis][i]) * inv_dir[axis][i];
+            Float t1 = (aabb.max[axis] - o[axis][i]) * inv_dir[axis][i];
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+
+            t_near = t0 > t_near ? t0 : t_near;
+            t_far = t1 < t_far ? t1 : t_far;
+        }
+
+        hit_mask |= uint64(t_near <= t_far) << i;
+    }
+
+    return hit_mask;
+#endif
+}
+
+template <typename T>
+void BVH::RayCastPacket(RayPacket* packet, std::span<const Ray> rays, T* callback) const
+{
+    struct StackEntry
+    {
+        int32 index;
+        uint64 mask;
+    };
+
+    // Rays that found any hit in an occlusion query leave the packet
+    uint64 active_mask = packet->size == 64 ? ~uint64(0) : (uint64(1) << packet->size) - 1;
+
+    GrowableArray<StackEntry, 64> stack;
+    stack.Emplace(0, active_mask);
+
+    while (stack.Count() > 0)
+    {
+        StackEntry entry = stack.Pop();
+
+        const LinearBVHNode& node = nodes[entry.index];
+        uint64 hit_mask = packet->TestAABB(node.aabb, entry.mask & active_mask);
+        if (hit_mask == 0)
+        {
+            continue;
+        }
+
+        if (node.primitive_count > 0)
+        {
+            // Leaf node
+            while (hit_mask)
+            {
+                int32 lane = std::countr_zero(hit_mask);
+                hit_mask &= hit_mask - 1;
+
+                bool terminated = false;
+                for (int32 i = 0; i < node.primitive_count; ++i)
+                {
+                    int32 index = node.primitives_offset + i;
+                    if (!triangles.IsEmpty() && (triangles.all_precomputed || triangles.precomputed[index]))
+                    {
+                        continue;
+                    }
+
+                    Float t = callback->RayCastCallback(lane, rays[lane], packet->t_min, packet->t_max[lane], primitives[index]);
+                    if (t <= packet->t_min)
+                    {
+                        terminated = true;
+                        break;
+                    }
+                    else
+                    {
+                        // Shorten the ray
+                        packet->t_max[lane] = t;
+                    }
+                }
+
+                if (!terminated && !triangles.IsEmpty())
+                {
+                    Float t_hit, u, v;
+                    int32 hit = triangles.Intersect(
+                        TriangleData::ShearedRay(rays[lane]), packet->t_min, packet->t_max[lane], node.primitives_offset,
+                        node.primitive_count, &t_hit, &u, &v
+                    );
+                    if (hit >= 0)
+                    {
+                        Float t = callback->RayCastTriangleCallback(lane, packet->t_min, hit, t_hit, u, v);
+                        if (t <= packet->t_min)
+                        {
+                            terminated = true;
+                        }
+                        else
+                        {
+                            packet->t_max[lane] = t;
+                        }
+                    }
+                }
+
+                if (terminated)
+                {
+                    active_mask &= ~(uint64(1) << lane);
+                }
+            }
+        }
+        else
+        {
+            // Internal node
+
+            // Rays of a packet are assumed coherent, so the first active ray decides the traversal order
+            int32 first_lane = std::countr_zero(hit_mask);
+            bool dir_neg = packet->inv_dir[node.axis][first_lane] < 0;
+
+            int32 child1 = node.child_offset;
+            int32 child2 = child1 + 1;
+
+            // Put far child on stack first
+            if (dir_neg)
+            {
+                stack.Emplace(child1, hit_mask);
+                stack.Emplace(child2, hit_mask);
+            }
+            else
+            {
+                stack.Emplace(child2, hit_mask);
+                stack.Emplace(child1, hit_mask);
+            }
+        }
+    }
+}
+
+void BVH::IntersectN(
+    std::span<Intersection> isects, std::span<bool> hits, std::span<const Ray> rays, Float t_min, Float t_max
+) const
+{
+    struct Callback
+    {
+        Intersection* closest;
+        bool* hit_closest;
+
+        // Precomputed triangle hits are resolved after the traversal
+        int32 closest_triangle[RayPacket::max_size];
+        Float t[RayPacket::max_size], u[RayPacket::max_size], v[RayPacket::max_size];
+
+        Float RayCastCallback(int32 lane, const Ray& ray, Float t_min, Float t_max, const Intersectable* object)
+        {
+            Intersection isect;
+            bool hit = object->Intersect(&isect, ray, t_min, t_max);
+
+            if (hit)
+            {
+                BulbitAssert(isect.t <= t_max);
+                hit_closest[lane] = true;
+                closest[lane] = isect;
+                closest_triangle[lane] = -1;
+                return isect.t;
+            }
+
+            // Keep traverse with smaller bounds
+            return t_max;
+        }
+
+        Float RayCastTriangleCallback(int32 lane, Float t_min, int32 index, Float t_hit, Float u_hit, Float v_hit)
+        {
+            BulbitNotUsed(t_min);
+
+            hit_closest[lane] = true;
+            closest_triangle[lane] = index;
+            t[lane] = t_hit;
+            u[lane] = u_hit;
+            v[lane] = v_hit;
+            return t_hit;
+        }
+    } callback;
+
+    for (size_t begin = 0; begin < rays.size(); begin += RayPacket::max_size)
+    {
+        size_t count = std::min(rays.size() - begin, size_t(RayPacket::max_size));
+        std::span<const Ray> packet_rays = rays.subspan(begin, count);
+
+        std::fill_n(hits.begin() + begin, count, false);
+        std::fill_n(callback.closest_triangle, count, -1);
+        callback.closest = isects.data() + begin;
+        callback.hit_closest = hits.data() + begin;
+
+        RayPacket packet(packet_rays, t_min, t_max);
+        RayCastPacket(&packet, packet_rays, &callback);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (callback.closest_triangle[i] < 0)
+            {
+                continue;
+            }
+
+            const Primitive* primitive = (const Primitive*)primitives[callback.closest_triangle[i]];
+            const Triangle* triangle = (const Triangle*)primitive->GetShape();
+
+            triangle->SetIntersection(&isects[begin + i], packet_rays[i], callback.t[i], callback.u[i], callback.v[i]);
+            isects[begin + i].primitive = primitive;
+        }
+    }
+}
+
+void BVH::IntersectAnyN(std::span<bool> hits, std::span<const Ray> rays, Float t_min, std::span<const Float> t_max) const
+{
+    struct Callback
+    {
+        bool* hit_any;
+
+        Float RayCastCallback(int32 lane, const Ray& ray, Float t_min, Float t_max, Intersectable* object)
+        {
+            bool hit = object->IntersectAny(ray, t_min, t_max);
+
+            if (hit)
+            {
+                hit_any[lane] = true;
+
+                // Remove the ray from the packet
+                return t_min;
+            }
+
+            return t_max;
+        }
+
+        Float RayCastTriangleCallback(int32 lane, Float t_min, int32 index, Float t_hit, Float u, Float v)
+        {
+            BulbitNotUsed(index);
+            BulbitNotUsed(t_hit);
+            BulbitNotUsed(u);
+            BulbitNotUsed(v);
+
+            hit_any[lane] = true;
+            return t_min;
+        }
+    } callback;
+
+    for (size_t begin = 0; begin < rays.size(); begin += RayPacket::max_size)
+    {
+        size_t count = std::min(rays.size() - begin, size_t(RayPacket::max_size));
+        std::span<const Ray> packet_rays = rays.subspan(begin, count);
+
+        std::fill_n(hits.begin() + begin, count, false);
+        callback.hit_any = hits.data() + begin;
+
+        RayPacket packet(packet_rays, t_min, 0);
+        for (size_t i = 0; i < count; ++i)
+        {
+            packet.t_max[i] = t_max[begin + i];
+        }
+
+        RayCastPacket(&packet, packet_rays, &callback);
+    }
+}
+
+} // namespace bulbit
@@ -0,0 +1,366 @@
+#include "bulbit/bvh.h"
+#include "bulbit/parallel_for.h"
+
+namespace bulbit
+{
+
+// Subtrees below this depth are refitted in parallel, up to 256 of them
+constexpr int32 refit_subtree_depth = 8;
+
+void BVH::SetupRefit()
+{
+    refit_roots.clear();
+    refit_costs.clear();
+    refit_top_nodes.clear();
+
+    if (node_count == 0)
+    {
+        return;
+    }
+
+    struct StackEntry
+    {
+        int32 index;
+        int32 depth;
+    };
+
+    GrowableArray<StackEntry, 64> stack;
+    stack.Emplace(0, 0);
+
+    // Visit the first child first so that the roots and the top nodes are collected in DFS order
+    while (stack.Count() > 0)
+    {
+        auto [index, depth] = stack.Pop();
+
+        if (nodes[index].primitive_count > 0 || depth == refit_subtree_depth)
+        {
+            refit_roots.push_back(index);
+            continue;
+        }
+
+        refit_top_nodes.push_back(index);
+        stack.Emplace(nodes[index].child_offset + 1, depth + 1);
+        stack.Emplace(nodes[index].child_offset, depth + 1);
+    }
+
+    refit_costs.resize(refit_roots.size());
+    ParallelFor(0, int32(refit_roots.size()), [&](int32 i) { refit_costs[i] = GetSubtreeSAHCost(refit_roots[i]); });
+
+    refit_total_cost = GetTotalSAHCost(refit_costs);
+}
+
+AABB BVH::RefitRecursive(int32 index)
+{
+    LinearBVHNode& node = nodes[index];
+
+    if (node.primitive_count > 0)
+    {
+        // Bounds of the whole primitive, references clipped by spatial splits become conservative
+        AABB aabb;
+        for (int32 i = 0; i < node.primitive_count; ++i)
+        {
+            aabb = AABB::Union(aabb, primitives[node.primitives_offset + i]->GetAABB());
+        }
+
+        node.aabb = aabb;
+    }
+    else
+    {
+        AABB aabb1 = RefitRecursive(node.child_offset);
+        AABB aabb2 = RefitRecursive(node.child_offset + 1);
+        node.aabb = AABB::Union(aabb1, aabb2);
+    }
+
+    return node.aabb;
+}
+
+Float BVH::GetSubtreeSAHCost(int32 index) const
+{
+    constexpr Float traverse_cost = 0.5f;
+
+    Float root_area = nodes[index].aabb.GetSurfaceArea();
+    if (root_area == 0)
+    {
+        return 0;
+    }
+
+    Float cost = 0;
+
+    GrowableArray<int32, 64> stack;
+    stack.Emplace(index);
+
+    while (stack.Count() > 0)
+    {
+        const LinearBVHNode& node = nodes[stack.Pop()];
+        if (node.primitive_count > 0)
+        {
+            cost += node.primitive_count * node.aabb.GetSurfaceArea();
+        }
+        else
+        {
+            cost += traverse_cost * node.aabb.GetSurfaceArea();
+            stack.Emplace(node.child_offset + 1);
+            stack.Emplace(node.child_offset);
+        }
+    }
+
+    return cost / root_area;
+}
+
+int32 BVH::Refit(Float rebuild_threshold)
+{
+    if (node_count == 0)
+    {
+        return 0;
+    }
+
+    // Mapped nodes are read only, take a copy
+    if (mapped_file)
+    {
+        LinearBVHNode* mapped_nodes = nodes;
+        nodes = AllocateNodes(node_count);
+        std::copy(mapped_nodes, mapped_nodes + node_count, nodes);
+
+        mapped_file.reset();
+    }
+
+    ParallelFor(0, int32(refit_roots.size()), [&](int32 i) { RefitRecursive(refit_roots[i]); });
+
+    // Children come after their parent in DFS order
+    for (auto it = refit_top_nodes.rbegin(); it != refit_top_nodes.rend(); ++it)
+    {
+        LinearBVHNode& node = nodes[*it];
+        node.aabb = AABB::Union(nodes[node.child_offset].aabb, nodes[node.child_offset + 1].aabb);
+    }
+
+    std::vector<Float> costs(refit_roots.size());
+    ParallelFor(0, int32(refit_roots.size()), [&](int32 i) { costs[i] = GetSubtreeSAHCost(refit_roots[i]); });
+
+    std::vector<int32> rebuild_roots;
+    if (GetTotalSAHCost(costs) > refit_total_cost * rebuild_threshold)
+    {
+        // Primitives moved across the subtrees, rebuild the whole tree
+        rebuild_roots.push_back(0);
+    }
+    else
+    {
+        for (size_t i = 0; i < refit_roots.size(); ++i)
+        {
+            // Leaves can not degrade
+            if (nodes[refit_roots[i]].primitive_count == 0 && costs[i] > refit_costs[i] * rebuild_threshold)
+            {
+                rebuild_roots.push_back(refit_roots[i]);
+            }
+        }
+    }
+
+    if (rebuild_roots.empty())
+    {
+        // Precomputed triangle data copies the vertex positions
+        if (!triangles.IsEmpty())
+        {
+            UpdateTriangles();
+        }
+
+        return 0;
+    }
+
+    RebuildSubtrees(rebuild_roots);
+
+    if (!triangles.IsEmpty())
+    {
+        PrecomputeTriangles();
+    }
+
+    return int32(rebuild_roots.size());
+}
+
+Float BVH::GetTotalSAHCost(const std::vector<Float>& subtree_costs) const
+{
+    constexpr Float traverse_cost = 0.5f;
+
+    Float root_area = nodes[0].aabb.GetSurfaceArea();
+    if (root_area == 0)
+    {
+        return 0;
+    }
+
+    // Assembled from the subtree costs to avoid another pass over all the nodes
+    Float cost = 0;
+    for (int32 index : refit_top_nodes)
+    {
+        cost += traverse_cost * nodes[index].aabb.GetSurfaceArea();
+    }
+
+    for (size_t i = 0; i < refit_roots.size(); ++i)
+    {
+        cost += subtree_costs[i] * nodes[refit_roots[i]].aabb.GetSurfaceArea();
+    }
+
+    return cost / root_area;
+}
+
+void BVH::RebuildSubtrees(const std::vector<int32>& roots)
+{
+    std::vector<std::unique_ptr<BufferResource>> thread_buffers;
+    ThreadLocal<Allocator> thread_allocators([&thread_buffers]() {
+        thread_buffers.push_back(std::make_unique<BufferResource>());
+        BufferResource* ptr = thread_buffers.back().get();
+        return Allocator(ptr);
+    });
+
+    struct Subtree
+    {
+        BuildNode* root;
+        std::vector<Intersectable*> ordered_prims;
+    };
+
+    int32 subtree_count = int32(roots.size());
+    std::vector<Subtree> subtrees(subtree_count);
+
+    ParallelFor(0, subtree_count, [&](int32 i) {
+        // Gather the references of the subtree, spatial splits may have put a primitive into several of its leaves
+        std::vector<int32> references;
+
+        GrowableArray<int32, 64> stack;
+        stack.Emplace(roots[i]);
+
+        while (stack.Count() > 0)
+        {
+            int32 index = stack.Pop();
+            const LinearBVHNode& node = nodes[index];
+            if (node.primitive_count > 0)
+            {
+                for (int32 j = 0; j < node.primitive_count; ++j)
+                {
+                    references.push_back(node.primitives_offset + j);
+                }
+            }
+            else
+            {
+                stack.Emplace(node.child_offset + 1);
+                stack.Emplace(node.child_offset);
+            }
+        }
+
+        std::sort(references.begin(), references.end(), [&](int32 a, int32 b) { return primitives[a] < primitives[b]; });
+        references.erase(
+            std::unique(
+                references.begin(), references.end(), [&](int32 a, int32 b) { return primitives[a] == primitives[b]; }
+            ),
+            references.end()
+        );
+
+        std::vector<BVHPrimitive> bvh_primitives(references.size());
+        for (size_t j = 0; j < references.size(); ++j)
+        {
+            bvh_primitives[j] = BVHPrimitive(references[j], primitives[references[j]]->GetAABB());
+        }
+
+        std::atomic<int32> total_nodes(0);
+        std::atomic<int32> ordered_prims_offset(0);
+
+        subtrees[i].ordered_prims.resize(references.size());
+        subtrees[i].root = BuildRecursive(
+            thread_allocators, std::span<BVHPrimitive>(bvh_primitives), &total_nodes, &ordered_prims_offset,
+            subtrees[i].ordered_prims
+        );
+    });
+
+    // Subtree roots are looked up by node index while copying
+    std::vector<int32> subtree_indices(node_count, -1);
+    for (int32 i = 0; i < subtree_count; ++i)
+    {
+        subtree_indices[roots[i]] = i;
+    }
+
+    std::vector<uint8> kept_roots(node_count, 0);
+    for (int32 index : refit_roots)
+    {
+        kept_roots[index] = 1;
+    }
+
+    std::vector<LinearBVHNode> new_nodes;
+    std::vector<Intersectable*> new_primitives;
+    new_nodes.reserve(node_count);
+    new_primitives.reserve(primitives.size());
+
+    // Children are appended as sibling pairs, then their subtrees are laid out depth first
+    auto emit_build_node = [&](auto& self, const BuildNode* node, int32 node_index, int32 primitive_base) -> void {
+        new_nodes[node_index].aabb = node->aabb;
+
+        if (node->count > 0)
+        {
+            new_nodes[node_index].primitives_offset = primitive_base + node->offset;
+            new_nodes[node_index].primitive_count = uint16(node->count);
+        }
+        else
+        {
+            int32 child_offset = int32(new_nodes.size());
+            new_nodes.resize(child_offset + 2);
+
+            new_nodes[node_index].axis = uint8(node->axis);
+            new_nodes[node_index].primitive_count = 0;
+            new_nodes[node_index].child_offset = child_offset;
+
+            self(self, node->child1, child_offset, primitive_base);
+            self(self, node->child2, child_offset + 1, primitive_base);
+        }
+    };
+
+    auto emit = [&](auto& self, int32 index, int32 node_index, bool kept) -> void {
+        if (!kept && subtree_indices[index] >= 0)
+        {
+            const Subtree& subtree = subtrees[subtree_indices[index]];
+
+            int32 primitive_base = int32(new_primitives.size());
+            new_primitives.insert(new_primitives.end(), subtree.ordered_prims.begin(), subtree.ordered_prims.end());
+            return emit_build_node(emit_build_node, subtree.root, node_index, primitive_base);
+        }
+
+        // Nodes of the kept subtrees are copied as they are, only the offsets change
+        kept = kept || kept_roots[index];
+
+        const LinearBVHNode& node = nodes[index];
+        new_nodes[node_index] = node;
+
+        if (node.primitive_count > 0)
+        {
+            new_nodes[node_index].primitives_offset = int32(new_primitives.size());
+            new_primitives.insert(
+                new_primitives.end(), primitives.begin() + node.primitives_offset,
+                primitives.begin() + node.primitives_offset + node.primitive_count
+            );
+        }
+        else
+        {
+            int32 child_offset = int32(new_nodes.size());
+            new_nodes.resize(child_offset + 2);
+            new_nodes[node_index].child_offset = child_offset;
+
+            self(self, node.child_offset, child_offset, kept);
+            self(self, node.child_offset + 1, child_offset + 1, kept);
+        }
+    };
+
+    new_nodes.resize(1);
+    emit(emit, 0, 0, false);
+
+    FreeNodes(nodes);
+    node_count = int32(new_nodes.size());
+    nodes = AllocateNodes(node_count);
+    std::copy(new_nodes.begin(), new_nodes.end(), nodes);
+    primitives = std::move(new_primitives);
+
+    // Measure the new subtrees against their own cost from now on
+    if (reordered)
+    {
+        ReorderNodes();
+    }
+    else
+    {
+        SetupRefit();
+    }
+}
+
+} // namespace bulbit
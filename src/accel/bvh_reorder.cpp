@@ -0,0 +1,113 @@
+#include "bulbit/bvh.h"
+
+#include <queue>
+
+namespace bulbit
+{
+
+void BVH::ReorderNodes()
+{
+    // Sibling pairs per treelet, a treelet fills one page
+    constexpr int32 treelet_pair_count = 4096 / (2 * sizeof(LinearBVHNode));
+
+    if (node_count < 3)
+    {
+        reordered = true;
+        return;
+    }
+
+    // Pair p holds the nodes 1 + 2p and 2 + 2p, the root is the only node without a sibling
+    int32 pair_count = (node_count - 1) / 2;
+
+    struct PairEntry
+    {
+        Float area;
+        int32 pair;
+
+        bool operator<(const PairEntry& other) const
+        {
+            return area < other.area;
+        }
+    };
+
+    std::vector<int32> new_pair_indices(pair_count, -1);
+    int32 new_pair_count = 0;
+
+    // Treelets are grown greedily from the pair with the largest parent, which is the most likely one to be visited
+    // Pairs left on the frontier become the roots of the next treelets, laid out depth first
+    std::vector<PairEntry> treelet_roots;
+    treelet_roots.push_back(PairEntry{ nodes[0].aabb.GetSurfaceArea(), (nodes[0].child_offset - 1) / 2 });
+
+    while (!treelet_roots.empty())
+    {
+        std::priority_queue<PairEntry> frontier;
+        frontier.push(treelet_roots.back());
+        treelet_roots.pop_back();
+
+        int32 treelet_size = 0;
+        while (!frontier.empty() && treelet_size < treelet_pair_count)
+        {
+            int32 pair = frontier.top().pair;
+            frontier.pop();
+
+            new_pair_indices[pair] = new_pair_count++;
+            ++treelet_size;
+
+            for (int32 i = 1; i <= 2; ++i)
+            {
+                const LinearBVHNode& node = nodes[2 * pair + i];
+                if (node.primitive_count == 0)
+                {
+                    frontier.push(PairEntry{ node.aabb.GetSurfaceArea(), (node.child_offset - 1) / 2 });
+                }
+            }
+        }
+
+        // Largest on top of the stack so that the most likely subtree is laid out next
+        size_t first_root = treelet_roots.size();
+        while (!frontier.empty())
+        {
+            treelet_roots.push_back(frontier.top());
+            frontier.pop();
+        }
+
+        std::reverse(treelet_roots.begin() + first_root, treelet_roots.end());
+    }
+
+    BulbitAssert(new_pair_count == pair_count);
+
+    LinearBVHNode* new_nodes = AllocateNodes(node_count);
+    new_nodes[0] = nodes[0];
+    for (int32 pair = 0; pair < pair_count; ++pair)
+    {
+        int32 new_pair = new_pair_indices[pair];
+        new_nodes[2 * new_pair + 1] = nodes[2 * pair + 1];
+        new_nodes[2 * new_pair + 2] = nodes[2 * pair + 2];
+    }
+
+    for (int32 i = 0; i < node_count; ++i)
+    {
+        LinearBVHNode& node = new_nodes[i];
+        if (node.primitive_count == 0)
+        {
+            node.child_offset = 2 * new_pair_indices[(node.child_offset - 1) / 2] + 1;
+        }
+    }
+
+    if (mapped_file)
+    {
+        mapped_file.reset();
+    }
+    else
+    {
+        FreeNodes(nodes);
+    }
+
+    nodes = new_nodes;
+    reordered = true;
+
+    // Refit roots are node indices
+    SetupRefit();
+}
+
+} // namespace bulbit
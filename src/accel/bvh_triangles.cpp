@@ -0,0 +1,346 @@
+#include "bulbit/bvh.h"
+#include "bulbit/material.h"
+#include "bulbit/mesh.h"
+#include "bulbit/parallel_for.h"
+#include "bulbit/shapes.h"
+#include "bulbit/simd.h"
+
+namespace bulbit
+{
+
+// Chunks keep the task overhead low for large meshes
+constexpr int32 triangle_chunk_size = 1024;
+
+void BVH::PrecomputeTriangles()
+{
+    int32 count = int32(primitives.size());
+    size_t size = primitives.size() + TriangleData::padding;
+
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        triangles.p0[axis].assign(size, 0);
+        triangles.p1[axis].assign(size, 0);
+        triangles.p2[axis].assign(size, 0);
+    }
+    triangles.precomputed.assign(size, 0);
+
+    int32 chunk_count = (count + triangle_chunk_size - 1) / triangle_chunk_size;
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32 begin = chunk * triangle_chunk_size;
+        int32 end = std::min(begin + triangle_chunk_size, count);
+
+        for (int32 i = begin; i < end; ++i)
+        {
+            const Primitive* primitive = dynamic_cast<const Primitive*>(primitives[i]);
+            if (!primitive)
+            {
+                continue;
+            }
+
+            const Triangle* triangle = dynamic_cast<const Triangle*>(primitive->GetShape());
+            if (!triangle)
+            {
+                continue;
+            }
+
+            // Alpha tested triangles need the full Primitive::Intersect
+            const Material* material = primitive->GetMaterial();
+            if (material && material->GetAlphaTexture())
+            {
+                continue;
+            }
+
+            SetTriangle(i, triangle);
+            triangles.precomputed[i] = 1;
+        }
+    });
+
+    triangles.all_precomputed = std::all_of(
+        triangles.precomputed.begin(), triangles.precomputed.begin() + count, [](uint8 precomputed) { return precomputed != 0; }
+    );
+}
+
+void BVH::UpdateTriangles()
+{
+    int32 count = int32(primitives.size());
+    int32 chunk_count = (count + triangle_chunk_size - 1) / triangle_chunk_size;
+
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32 begin = chunk * triangle_chunk_size;
+        int32 end = std::min(begin + triangle_chunk_size, count);
+
+        for (int32 i = begin; i < end; ++i)
+        {
+            if (triangles.precomputed[i])
+            {
+                SetTriangle(i, (const Triangle*)((const Primitive*)primitives[i])->GetShape());
+            }
+        }
+    });
+}
+
+void BVH::SetTriangle(int32 index, const Triangle* triangle)
+{
+    const Point3& p0 = triangle->mesh->positions[triangle->v[0]];
+    const Point3& p1 = triangle->mesh->positions[triangle->v[1]];
+    const Point3& p2 = triangle->mesh->positions[triangle->v[2]];
+
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        triangles.p0[axis][index] = p0[axis];
+        triangles.p1[axis][index] = p1[axis];
+        triangles.p2[axis][index] = p2[axis];
+    }
+}
+
+// Watertight ray triangle intersection (Woop et al. 2013)
+// The vertices are translated to the ray origin and sheared so that the ray runs along +z, then the signs of the 2D
+// edge functions U, V, W decide the hit. Neighboring triangles evaluate a shared edge with the same inputs, so a ray
+// through the edge can not slip between them. Edge functions that round to zero count as inside. The signs come from
+// comparing the two products of each edge function, so a fused multiply-add in the subtraction can not round the edge
+// differently for the two triangles sharing it.
+// With det = U + V + W the barycentrics of p1 and p2 are V / det and W / det, which is the u, v convention of
+// Triangle::Intersect, and t is in the parametrization of the given ray
+int32 BVH::TriangleData::Intersect(
+    const ShearedRay& ray, Float t_min, Float t_max, int32 offset, int32 count, Float* t, Float* u, Float* v
+) const
+{
+    const int32 kx = ray.kx, ky = ray.ky, kz = ray.kz;
+
+    int32 closest = -1;
+
+#if defined(BULBIT_SIMD_AVX) && defined(BULBIT_SIMD_FLOAT)
+    {
+        const __m256 ox = _mm256_set1_ps(ray.o[kx]), oy = _mm256_set1_ps(ray.o[ky]), oz = _mm256_set1_ps(ray.o[kz]);
+        const __m256 sx = _mm256_set1_ps(ray.sx), sy = _mm256_set1_ps(ray.sy), sz = _mm256_set1_ps(ray.sz);
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1);
+        const __m256 t_lower = _mm256_set1_ps(t_min);
+
+        alignas(32) float lane_t[8], lane_u[8], lane_v[8];
+
+        for (int32 i = 0; i < count; i += 8)
+        {
+            const int32 base = offset + i;
+
+            // Vertices relative to the ray origin, sheared in the xy plane
+            const __m256 az = _mm256_sub_ps(_mm256_loadu_ps(p0[kz].data() + base), oz);
+            const __m256 bz = _mm256_sub_ps(_mm256_loadu_ps(p1[kz].data() + base), oz);
+            const __m256 cz = _mm256_sub_ps(_mm256_loadu_ps(p2[kz].data() + base), oz);
+
+            const __m256 ax = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(p0[kx].data() + base), ox), _mm256_mul_ps(sx, az));
+            const __m256 ay = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(p0[ky].data() + base), oy), _mm256_mul_ps(sy, az));
+            const __m256 bx = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(p1[kx].data() + base), ox), _mm256_mul_ps(sx, bz));
+            const __m256 by = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(p1[ky].data() + base), oy), _mm256_mul_ps(sy, bz));
+            const __m256 cx = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(p2[kx].data() + base), ox), _mm256_mul_ps(sx, cz));
+            const __m256 cy = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(p2[ky].data() + base), oy), _mm256_mul_ps(sy, cz));
+
+            const __m256 u0 = _mm256_mul_ps(cx, by), u1 = _mm256_mul_ps(cy, bx);
+            const __m256 v0 = _mm256_mul_ps(ax, cy), v1 = _mm256_mul_ps(ay, cx);
+            const __m256 w0 = _mm256_mul_ps(bx, ay), w1 = _mm256_mul_ps(by, ax);
+
+            const __m256 eu = _mm256_sub_ps(u0, u1);
+            const __m256 ev = _mm256_sub_ps(v0, v1);
+            const __m256 ew = _mm256_sub_ps(w0, w1);
+
+            const __m256 det = _mm256_add_ps(_mm256_add_ps(eu, ev), ew);
+            const __m256 inv_det = _mm256_div_ps(one, det);
+
+            const __m256 tt = _mm256_mul_ps(
+                sz, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(eu, az), _mm256_mul_ps(ev, bz)), _mm256_mul_ps(ew, cz))
+            );
+
+            const __m256 bu = _mm256_mul_ps(ev, inv_det);
+            const __m256 bv = _mm256_mul_ps(ew, inv_det);
+            const __m256 bt = _mm256_mul_ps(tt, inv_det);
+
+            // The edge functions must not have different signs, ordered comparisons reject the NaN lanes
+            const __m256 inside_positive = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(u0, u1, _CMP_GE_OQ), _mm256_cmp_ps(v0, v1, _CMP_GE_OQ)),
+                _mm256_cmp_ps(w0, w1, _CMP_GE_OQ)
+            );
+            const __m256 inside_negative = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(u0, u1, _CMP_LE_OQ), _mm256_cmp_ps(v0, v1, _CMP_LE_OQ)),
+                _mm256_cmp_ps(w0, w1, _CMP_LE_OQ)
+            );
+
+            __m256 mask = _mm256_or_ps(inside_positive, inside_negative);
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(bt, t_lower, _CMP_GE_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(bt, _mm256_set1_ps(t_max), _CMP_LE_OQ));
+
+            uint32 hit_mask = uint32(_mm256_movemask_ps(mask));
+            if (count - i < 8)
+            {
+                hit_mask &= (1u << (count - i)) - 1;
+            }
+
+            if (hit_mask == 0)
+            {
+                continue;
+            }
+
+            _mm256_store_ps(lane_t, bt);
+            _mm256_store_ps(lane_u, bu);
+            _mm256_store_ps(lane_v, bv);
+
+            while (hit_mask)
+            {
+                int32 lane = std::countr_zero(hit_mask);
+                hit_mask &= hit_mask - 1;
+
+                if (lane_t[lane] <= t_max)
+                {
+                    t_max = lane_t[lane];
+                    closest = base + lane;
+                    *t = lane_t[lane];
+                    *u = lane_u[lane];
+                    *v = lane_v[lane];
+                }
+            }
+        }
+
+        return closest;
+    }
+#elif defined(BULBIT_SIMD_SSE) && defined(BULBIT_SIMD_FLOAT)
+    {
+        const __m128 ox = _mm_set1_ps(ray.o[kx]), oy = _mm_set1_ps(ray.o[ky]), oz = _mm_set1_ps(ray.o[kz]);
+        const __m128 sx = _mm_set1_ps(ray.sx), sy = _mm_set1_ps(ray.sy), sz = _mm_set1_ps(ray.sz);
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1);
+        const __m128 t_lower = _mm_set1_ps(t_min);
+
+        alignas(16) float lane_t[4], lane_u[4], lane_v[4];
+
+        for (int32 i = 0; i < count; i += 4)
+        {
+            const int32 base = offset + i;
+
+            const __m128 az = _mm_sub_ps(_mm_loadu_ps(p0[kz].data() + base), oz);
+            const __m128 bz = _mm_sub_ps(_mm_loadu_ps(p1[kz].data() + base), oz);
+            const __m128 cz = _mm_sub_ps(_mm_loadu_ps(p2[kz].data() + base), oz);
+
+            const __m128 ax = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(p0[kx].data() + base), ox), _mm_mul_ps(sx, az));
+            const __m128 ay = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(p0[ky].data() + base), oy), _mm_mul_ps(sy, az));
+            const __m128 bx = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(p1[kx].data() + base), ox), _mm_mul_ps(sx, bz));
+            const __m128 by = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(p1[ky].data() + base), oy), _mm_mul_ps(sy, bz));
+            const __m128 cx = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(p2[kx].data() + base), ox), _mm_mul_ps(sx, cz));
+            const __m128 cy = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(p2[ky].data() + base), oy), _mm_mul_ps(sy, cz));
+
+            const __m128 u0 = _mm_mul_ps(cx, by), u1 = _mm_mul_ps(cy, bx);
+            const __m128 v0 = _mm_mul_ps(ax, cy), v1 = _mm_mul_ps(ay, cx);
+            const __m128 w0 = _mm_mul_ps(bx, ay), w1 = _mm_mul_ps(by, ax);
+
+            const __m128 eu = _mm_sub_ps(u0, u1);
+            const __m128 ev = _mm_sub_ps(v0, v1);
+            const __m128 ew = _mm_sub_ps(w0, w1);
+
+            const __m128 det = _mm_add_ps(_mm_add_ps(eu, ev), ew);
+            const __m128 inv_det = _mm_div_ps(one, det);
+
+            const __m128 tt =
+                _mm_mul_ps(sz, _mm_add_ps(_mm_add_ps(_mm_mul_ps(eu, az), _mm_mul_ps(ev, bz)), _mm_mul_ps(ew, cz)));
+
+            const __m128 bu = _mm_mul_ps(ev, inv_det);
+            const __m128 bv = _mm_mul_ps(ew, inv_det);
+            const __m128 bt = _mm_mul_ps(tt, inv_det);
+
+            const __m128 inside_positive =
+                _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u0, u1), _mm_cmpge_ps(v0, v1)), _mm_cmpge_ps(w0, w1));
+            const __m128 inside_negative =
+                _mm_and_ps(_mm_and_ps(_mm_cmple_ps(u0, u1), _mm_cmple_ps(v0, v1)), _mm_cmple_ps(w0, w1));
+
+            __m128 mask = _mm_or_ps(inside_positive, inside_negative);
+            mask = _mm_and_ps(mask, _mm_cmpneq_ps(det, zero));
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(bt, t_lower));
+            mask = _mm_and_ps(mask, _mm_cmple_ps(bt, _mm_set1_ps(t_max)));
+
+            uint32 hit_mask = uint32(_mm_movemask_ps(mask));
+            if (count - i < 4)
+            {
+                hit_mask &= (1u << (count - i)) - 1;
+            }
+
+            if (hit_mask == 0)
+            {
+                continue;
+            }
+
+            _mm_store_ps(lane_t, bt);
+            _mm_store_ps(lane_u, bu);
+            _mm_store_ps(lane_v, bv);
+
+            while (hit_mask)
+            {
+                int32 lane = std::countr_zero(hit_mask);
+                hit_mask &= hit_mask - 1;
+
+                if (lane_t[lane] <= t_max)
+                {
+                    t_max = lane_t[lane];
+                    closest = base + lane;
+                    *t = lane_t[lane];
+                    *u = lane_u[lane];
+                    *v = lane_v[lane];
+                }
+            }
+        }
+
+        return closest;
+    }
+#else
+    for (int32 i = offset; i < offset + count; ++i)
+    {
+        Float az = p0[kz][i] - ray.o[kz];
+        Float bz = p1[kz][i] - ray.o[kz];
+        Float cz = p2[kz][i] - ray.o[kz];
+
+        Float ax = p0[kx][i] - ray.o[kx] - ray.sx * az;
+        Float ay = p0[ky][i] - ray.o[ky] - ray.sy * az;
+        Float bx = p1[kx][i] - ray.o[kx] - ray.sx * bz;
+        Float by = p1[ky][i] - ray.o[ky] - ray.sy * bz;
+        Float cx = p2[kx][i] - ray.o[kx] - ray.sx * cz;
+        Float cy = p2[ky][i] - ray.o[ky] - ray.sy * cz;
+
+        Float u0 = cx * by, u1 = cy * bx;
+        Float v0 = ax * cy, v1 = ay * cx;
+        Float w0 = bx * ay, w1 = by * ax;
+
+        if ((u0 < u1 || v0 < v1 || w0 < w1) && (u0 > u1 || v0 > v1 || w0 > w1))
+        {
+            continue;
+        }
+
+        Float eu = u0 - u1;
+        Float ev = v0 - v1;
+        Float ew = w0 - w1;
+
+        Float det = eu + ev + ew;
+        if (det == 0)
+        {
+            continue;
+        }
+
+        Float inv_det = 1 / det;
+
+        Float bt = ray.sz * (eu * az + ev * bz + ew * cz) * inv_det;
+        if (!(bt >= t_min && bt <= t_max))
+        {
+            continue;
+        }
+
+        t_max = bt;
+        closest = i;
+        *t = bt;
+        *u = ev * inv_det;
+        *v = ew * inv_det;
+    }
+
+    return closest;
+#endif
+}
+
+size_t BVH::TriangleData::GetMemoryUsage() const
+{
+    return precomputed.size() * (9 * sizeof(Float) + sizeof(uint8));
+}
+
+} // namespace bulbit
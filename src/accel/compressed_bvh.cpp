@@ -0,0 +1,284 @@
+#include "bulbit/compressed_bvh.h"
+#include "bulbit/hash_map.h"
+
+namespace bulbit
+{
+
+template <typename T>
+CompressedBVH<T>::CompressedBVH(const std::vector<Intersectable*>& primitives, BVHBuildMethod build_method, Float split_budget)
+    : CompressedBVH(BVH(primitives, build_method, split_budget), primitives)
+{
+}
+
+template <typename T>
+CompressedBVH<T>::CompressedBVH(const std::vector<Primitive*>& primitives, BVHBuildMethod build_method, Float split_budget)
+    : CompressedBVH(BVH(primitives, build_method, split_budget), primitives)
+{
+}
+
+template <typename T>
+CompressedBVH<T>::CompressedBVH(const BVH& bvh, const std::vector<Intersectable*>& primitives)
+    : intersectables{ primitives }
+    , aabb{ bvh.GetAABB() }
+{
+    SetReferences(bvh, primitives);
+    Compress(bvh, 0);
+}
+
+template <typename T>
+CompressedBVH<T>::CompressedBVH(const BVH& bvh, const std::vector<Primitive*>& primitives)
+    : scene_primitives{ primitives }
+    , aabb{ bvh.GetAABB() }
+{
+    SetReferences(bvh, primitives);
+    Compress(bvh, 0);
+}
+
+template <typename T>
+template <typename P>
+void CompressedBVH<T>::SetReferences(const BVH& bvh, const std::vector<P*>& primitives)
+{
+    HashMap<const Intersectable*, uint32> primitive_indices;
+    for (uint32 i = 0; i < uint32(primitives.size()); ++i)
+    {
+        primitive_indices.Insert(primitives[i], i);
+    }
+
+    references.resize(bvh.primitives.size());
+    for (size_t i = 0; i < bvh.primitives.size(); ++i)
+    {
+        BulbitAssert(primitive_indices.Contains(bvh.primitives[i]));
+        references[i] = primitive_indices.At(bvh.primitives[i]);
+    }
+}
+
+template <typename T>
+void CompressedBVH<T>::Node::SetFrame(const AABB& frame)
+{
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        // Round the origin down so that the frame covers the full precision bounds
+        float o = float(frame.min[axis]);
+        if (Float(o) > frame.min[axis])
+        {
+            o = std::nextafter(o, -std::numeric_limits<float>::infinity());
+        }
+
+        int32 e = -126;
+        Float extent = frame.max[axis] - Float(o);
+        if (extent > 0)
+        {
+            e = std::clamp(int32(std::ceil(std::log2(extent / q_max))), -126, 127);
+            while (e < 127 && Dequantize(o, q_max, e) < frame.max[axis])
+            {
+                ++e;
+            }
+        }
+
+        origin[axis] = o;
+        exponent[axis] = int8(e);
+    }
+}
+
+template <typename T>
+void CompressedBVH<T>::Node::SetChild(int32 child, const AABB& child_aabb, int32 child_offset, int32 child_count)
+{
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        Float scale = Dequantize(0, 1, exponent[axis]);
+        Float q0 = std::floor((child_aabb.min[axis] - origin[axis]) / scale);
+        Float q1 = std::ceil((child_aabb.max[axis] - origin[axis]) / scale);
+
+        int32 min = int32(std::clamp<Float>(q0, 0, q_max));
+        int32 max = int32(std::clamp<Float>(q1, 0, q_max));
+
+        // Fix up rounding errors of the division so that the quantized box always contains the original one
+        while (min > 0 && Dequantize(origin[axis], min, exponent[axis]) > child_aabb.min[axis])
+        {
+            --min;
+        }
+        while (max < q_max && Dequantize(origin[axis], max, exponent[axis]) < child_aabb.max[axis])
+        {
+            ++max;
+        }
+
+        bounds[child][0][axis] = T(min);
+        bounds[child][1][axis] = T(max);
+    }
+
+    offset[child] = child_offset;
+    count[child] = uint16(child_count);
+}
+
+template <typename T>
+void CompressedBVH<T>::Node::SetEmpty(int32 child)
+{
+    for (int32 axis = 0; axis < 3; ++axis)
+    {
+        bounds[child][0][axis] = 0;
+        bounds[child][1][axis] = 0;
+    }
+
+    offset[child] = -1;
+    count[child] = 0;
+}
+
+template <typename T>
+int32 CompressedBVH<T>::Compress(const BVH& bvh, int32 binary_index)
+{
+    const BVH::LinearBVHNode* binary_nodes = bvh.nodes;
+    const BVH::LinearBVHNode& binary_node = binary_nodes[binary_index];
+
+    int32 node_index = int32(nodes.size());
+    nodes.emplace_back();
+    nodes[node_index].SetFrame(binary_node.aabb);
+
+    if (binary_node.primitive_count > 0)
+    {
+        // Leaf root
+        nodes[node_index].axis = 0;
+        nodes[node_index].SetChild(0, binary_node.aabb, binary_node.primitives_offset, binary_node.primitive_count);
+        nodes[node_index].SetEmpty(1);
+        return node_index;
+    }
+
+    nodes[node_index].axis = binary_node.axis;
+
+    const int32 children[2] = { binary_node.child_offset, binary_node.child_offset + 1 };
+    for (int32 i = 0; i < 2; ++i)
+    {
+        const BVH::LinearBVHNode& child = binary_nodes[children[i]];
+        if (child.primitive_count > 0)
+        {
+            nodes[node_index].SetChild(i, child.aabb, child.primitives_offset, child.primitive_count);
+        }
+        else
+        {
+            // Recursion may reallocate the node array
+            int32 child_index = Compress(bvh, children[i]);
+            nodes[node_index].SetChild(i, child.aabb, child_index, 0);
+        }
+    }
+
+    return node_index;
+}
+
+template <typename T>
+bool CompressedBVH<T>::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    struct Callback
+    {
+        Intersection* closest;
+        bool hit_closest;
+        Float t;
+
+        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, const Intersectable* object)
+        {
+            Intersection isect;
+            bool hit = object->Intersect(&isect, ray, t_min, t_max);
+
+            if (hit)
+            {
+                BulbitAssert(isect.t <= t);
+                hit_closest = true;
+                t = isect.t;
+                *closest = isect;
+            }
+
+            // Keep traverse with smaller bounds
+            return t;
+        }
+    } callback;
+
+    callback.closest = isect;
+    callback.hit_closest = false;
+    callback.t = t_max;
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_closest;
+}
+
+template <typename T>
+bool CompressedBVH<T>::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    struct Callback
+    {
+        bool hit_any;
+
+        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, Intersectable* object)
+        {
+            bool hit = object->IntersectAny(ray, t_min, t_max);
+
+            if (hit)
+            {
+                hit_any = true;
+
+                // Stop traversal
+                return t_min;
+            }
+
+            return t_max;
+        }
+    } callback;
+
+    callback.hit_any = false;
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_any;
+}
+
+template <typename T>
+AABB CompressedBVH<T>::GetAABB() const
+{
+    return aabb;
+}
+
+template <typename T>
+Float CompressedBVH<T>::GetSAHCost() const
+{
+    constexpr Float traverse_cost = 0.5f;
+
+    // Measured on the dequantized boxes to include the cost of the looser bounds
+    Float cost = traverse_cost * aabb.GetSurfaceArea();
+    for (const Node& node : nodes)
+    {
+        for (int32 i = 0; i < 2; ++i)
+        {
+            if (node.offset[i] < 0)
+            {
+                continue;
+            }
+
+            Float area = node.GetChildAABB(i).GetSurfaceArea();
+            if (node.count[i] > 0)
+            {
+                cost += node.count[i] * area;
+            }
+            else
+            {
+                cost += traverse_cost * area;
+            }
+        }
+    }
+
+    return cost / aabb.GetSurfaceArea();
+}
+
+template <typename T>
+int32 CompressedBVH<T>::GetNodeCount() const
+{
+    return int32(nodes.size());
+}
+
+template <typename T>
+size_t CompressedBVH<T>::GetMemoryUsage() const
+{
+    return sizeof(CompressedBVH) + nodes.size() * sizeof(Node) + references.size() * sizeof(uint32);
+}
+
+template class CompressedBVH<uint8>;
+template class CompressedBVH<uint16>;
+
+} // namespace bulbit
@@ -1,5 +1,6 @@
 #include "bulbit/dynamic_bvh.h"
 #include "bulbit/intersectable.h"
+#include "bulbit/parallel_for.h"
 
 namespace bulbit
 {
@@ -374,44 +375,290 @@ bool DynamicBVH::MoveNode(NodeIndex node, AABB aabb, const Vec3& displacement, b
         return false;
     }
 
-    Vec3 d = displacement;
+    RemoveLeaf(node);
+
+    nodes[node].aabb = Extend(aabb, displacement);
+
+    InsertLeaf(node);
+
+    nodes[node].moved = true;
+
+    return true;
+}
+
+void DynamicBVH::RemoveNode(NodeIndex node)
+{
+    BulbitAssert(0 <= node && node < nodeCapacity);
+    BulbitAssert(nodes[node].IsLeaf());
+
+    RemoveLeaf(node);
+    FreeNode(node);
+}
+
+void DynamicBVH::CreateNodes(std::span<const Primitive* const> primitives, std::span<const AABB> aabbs, NodeIndex* out_nodes)
+{
+    BulbitAssert(primitives.size() == aabbs.size());
+
+    int32 count = int32(primitives.size());
+    int32 leaf_count = (nodeCount + 1) / 2 + count;
 
-    if (d.x > 0.0f)
+    for (int32 i = 0; i < count; ++i)
     {
-        aabb.max.x += d.x;
+        out_nodes[i] = PoolNode(primitives[i], aabbs[i]);
+    }
+
+    if (ShouldRebuild(count, leaf_count))
+    {
+        // Picks up the pooled leaves
+        Rebuild();
     }
     else
     {
-        aabb.min.x += d.x;
+        InsertLeaves(std::span<const NodeIndex>(out_nodes, count));
+    }
+}
+
+int32 DynamicBVH::MoveNodes(
+    std::span<const NodeIndex> leaves, std::span<const AABB> aabbs, std::span<const Vec3> displacements, bool force_move
+)
+{
+    BulbitAssert(leaves.size() == aabbs.size() && leaves.size() == displacements.size());
+
+    int32 count = int32(leaves.size());
+
+    // Same test as MoveNode, the tree is only read here
+    std::vector<uint8> moved(count);
+    ParallelFor(0, count, [&](int32 i) {
+        BulbitAssert(0 <= leaves[i] && leaves[i] < nodeCapacity);
+        BulbitAssert(nodes[leaves[i]].IsLeaf());
+
+        moved[i] = force_move || !nodes[leaves[i]].aabb.Contains(aabbs[i]);
+    });
+
+    std::vector<NodeIndex> moved_leaves;
+    for (int32 i = 0; i < count; ++i)
+    {
+        if (moved[i])
+        {
+            moved_leaves.push_back(leaves[i]);
+        }
+    }
+
+    int32 moved_count = int32(moved_leaves.size());
+    if (moved_count == 0)
+    {
+        return 0;
+    }
+
+    bool rebuild = ShouldRebuild(moved_count, (nodeCount + 1) / 2);
+    if (!rebuild)
+    {
+        for (NodeIndex leaf : moved_leaves)
+        {
+            RemoveLeaf(leaf);
+            nodes[leaf].parent = null_node;
+        }
     }
 
-    if (d.y > 0.0f)
+    ParallelFor(0, count, [&](int32 i) {
+        if (moved[i])
+        {
+            nodes[leaves[i]].aabb = Extend(aabbs[i], displacements[i]);
+            nodes[leaves[i]].moved = true;
+        }
+    });
+
+    if (rebuild)
     {
-        aabb.max.y += d.y;
+        Rebuild();
     }
     else
     {
-        aabb.min.y += d.y;
+        InsertLeaves(moved_leaves);
     }
 
-    RemoveLeaf(node);
+    return moved_count;
+}
 
-    nodes[node].aabb = aabb;
+void DynamicBVH::InsertLeaves(std::span<const NodeIndex> leaves)
+{
+    int32 count = int32(leaves.size());
 
-    InsertLeaf(node);
+    AABB center_bounds;
+    for (NodeIndex leaf : leaves)
+    {
+        center_bounds = AABB::Union(center_bounds, nodes[leaf].aabb.GetCenter());
+    }
 
-    nodes[node].moved = true;
+    constexpr int32 morton_scale = 1 << 10;
+    const Vec3 extents = center_bounds.GetExtents();
 
-    return true;
+    struct MortonLeaf
+    {
+        uint32 code;
+        NodeIndex leaf;
+    };
+
+    std::vector<MortonLeaf> morton_leaves(count);
+    ParallelFor(0, count, [&](int32 i) {
+        Vec3 offset = nodes[leaves[i]].aabb.GetCenter() - center_bounds.min;
+
+        uint32 q[3];
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            q[axis] = extents[axis] > 0 ? uint32(offset[axis] / extents[axis] * morton_scale) : 0;
+        }
+
+        morton_leaves[i].code = EncodeMorton3(q[0], q[1], q[2]);
+        morton_leaves[i].leaf = leaves[i];
+    });
+
+    std::sort(morton_leaves.begin(), morton_leaves.end(), [](const MortonLeaf& a, const MortonLeaf& b) {
+        return a.code < b.code;
+    });
+
+    for (const MortonLeaf& morton_leaf : morton_leaves)
+    {
+        InsertLeaf(morton_leaf.leaf);
+    }
 }
 
-void DynamicBVH::RemoveNode(NodeIndex node)
+void DynamicBVH::Flatten(Snapshot* snapshot) const
 {
-    BulbitAssert(0 <= node && node < nodeCapacity);
-    BulbitAssert(nodes[node].IsLeaf());
+    snapshot->nodes.clear();
+    snapshot->primitives.clear();
 
-    RemoveLeaf(node);
-    FreeNode(node);
+    if (root == null_node)
+    {
+        return;
+    }
+
+    snapshot->nodes.reserve(nodeCount);
+
+    struct StackEntry
+    {
+        NodeIndex node;
+        int32 parent;
+    };
+
+    // Parent is set for second children, whose index is patched into the parent once known
+    GrowableArray<StackEntry, 64> stack;
+    stack.Emplace(root, -1);
+
+    while (stack.Count() > 0)
+    {
+        auto [current, parent] = stack.Pop();
+
+        int32 index = int32(snapshot->nodes.size());
+        if (parent >= 0)
+        {
+            snapshot->nodes[parent].offset = index;
+        }
+
+        Snapshot::LinearNode& node = snapshot->nodes.emplace_back();
+        node.aabb = nodes[current].aabb;
+
+        if (nodes[current].IsLeaf())
+        {
+            node.offset = int32(snapshot->primitives.size());
+            node.leaf = true;
+            node.axis = 0;
+            snapshot->primitives.push_back(nodes[current].primitive);
+        }
+        else
+        {
+            NodeIndex child1 = nodes[current].child1;
+            NodeIndex child2 = nodes[current].child2;
+
+            // Order by the axis that separates the children the most
+            Vec3 d = nodes[child2].aabb.GetCenter() - nodes[child1].aabb.GetCenter();
+            Vec3 ad(std::abs(d.x), std::abs(d.y), std::abs(d.z));
+            int32 axis = ad.x > ad.y ? (ad.x > ad.z ? 0 : 2) : (ad.y > ad.z ? 1 : 2);
+
+            // Near child first for rays along the axis
+            if (d[axis] < 0)
+            {
+                std::swap(child1, child2);
+            }
+
+            node.leaf = false;
+            node.axis = uint8(axis);
+
+            stack.Emplace(child2, index);
+            stack.Emplace(child1, -1);
+        }
+    }
+}
+
+AABB DynamicBVH::Snapshot::GetAABB() const
+{
+    return nodes.empty() ? AABB() : nodes[0].aabb;
+}
+
+bool DynamicBVH::Snapshot::Intersect(Intersection* is, const Ray& ray, Float t_min, Float t_max) const
+{
+    struct Callback
+    {
+        Intersection* is;
+        bool hit_closest;
+        Float t;
+
+        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, const Intersectable* object)
+        {
+            bool hit = object->Intersect(is, ray, t_min, t_max);
+
+            if (hit)
+            {
+                hit_closest = true;
+                t = is->t;
+            }
+
+            // Keep traverse with smaller bounds
+            return t;
+        }
+    } callback;
+
+    callback.is = is;
+    callback.hit_closest = false;
+    callback.t = t_max;
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_closest;
+}
+
+bool DynamicBVH::Snapshot::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    struct Callback
+    {
+        bool hit_any;
+
+        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, const Intersectable* object)
+        {
+            bool hit = object->IntersectAny(ray, t_min, t_max);
+
+            if (hit)
+            {
+                hit_any = true;
+
+                // Stop traversal
+                return t_min;
+            }
+
+            return t_max;
+        }
+    } callback;
+
+    callback.hit_any = false;
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_any;
+}
+
+int32 DynamicBVH::Snapshot::GetNodeCount() const
+{
+    return int32(nodes.size());
 }
 
 void DynamicBVH::Rotate(NodeIndex node)
@@ -663,7 +910,8 @@ void DynamicBVH::Rebuild()
 
         NodeIndex node = n.node;
 
-        AABB& aabb = nodes[node].aabb;
+        // Recycled nodes still hold their old bounds
+        AABB aabb;
         for (int32 i = n.begin; i < n.end; ++i)
         {
             aabb = AABB::Union(aabb, nodes[primitives[i]].aabb);
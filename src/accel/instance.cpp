@@ -0,0 +1,51 @@
+#include "bulbit/instance.h"
+
+namespace bulbit
+{
+
+Instance::Instance(const Intersectable* object, const Transform& transform)
+    : object{ object }
+    , transform{ transform }
+{
+    // Bound the transformed corners of the object bounds
+    AABB object_aabb = object->GetAABB();
+    for (int32 i = 0; i < 8; ++i)
+    {
+        Point3 corner(
+            (i & 1) ? object_aabb.max.x : object_aabb.min.x, (i & 2) ? object_aabb.max.y : object_aabb.min.y,
+            (i & 4) ? object_aabb.max.z : object_aabb.min.z
+        );
+
+        aabb = AABB::Union(aabb, Mul(transform, corner));
+    }
+}
+
+AABB Instance::GetAABB() const
+{
+    return aabb;
+}
+
+bool Instance::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    // The ray direction is not normalized, so the hit distance stays the same in object space
+    Ray object_ray = MulT(transform, ray);
+    if (!object->Intersect(isect, object_ray, t_min, t_max))
+    {
+        return false;
+    }
+
+    // Transform the intersection back to the world space
+    isect->point = Mul(transform, isect->point);
+    isect->normal = Normalize(transform.q.Rotate(isect->normal / transform.s));
+    isect->shading.normal = Normalize(transform.q.Rotate(isect->shading.normal / transform.s));
+    isect->shading.tangent = Normalize(transform.q.Rotate(isect->shading.tangent * transform.s));
+
+    return true;
+}
+
+bool Instance::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    return object->IntersectAny(MulT(transform, ray), t_min, t_max);
+}
+
+} // namespace bulbit
@@ -0,0 +1,427 @@
+#include "bulbit/bvh.h"
+#include "bulbit/parallel_for.h"
+
+namespace bulbit
+{
+
+struct MortonPrimitive
+{
+    uint32 code;
+    int32 index;
+};
+
+// Stable LSD radix sort, each pass counts and scatters the chunks in parallel
+static void RadixSort(std::vector<MortonPrimitive>* v, int32 chunk_count)
+{
+    constexpr int32 bits_per_pass = 8;
+    constexpr int32 bucket_count = 1 << bits_per_pass;
+    constexpr int32 bit_mask = bucket_count - 1;
+    constexpr int32 pass_count = 32 / bits_per_pass;
+    static_assert(pass_count % 2 == 0, "Sorted values must end up in the input vector");
+
+    const int32 count = int32(v->size());
+    const int32 chunk_size = (count + chunk_count - 1) / chunk_count;
+
+    std::vector<MortonPrimitive> temp(count);
+    std::vector<int32> offsets(chunk_count * bucket_count);
+
+    for (int32 pass = 0; pass < pass_count; ++pass)
+    {
+        const int32 low_bit = pass * bits_per_pass;
+
+        std::vector<MortonPrimitive>& in = (pass & 1) ? temp : *v;
+        std::vector<MortonPrimitive>& out = (pass & 1) ? *v : temp;
+
+        ParallelFor(0, chunk_count, [&](int32 chunk) {
+            int32* histogram = &offsets[chunk * bucket_count];
+            std::fill(histogram, histogram + bucket_count, 0);
+
+            int32 end = std::min(count, (chunk + 1) * chunk_size);
+            for (int32 i = chunk * chunk_size; i < end; ++i)
+            {
+                ++histogram[(in[i].code >> low_bit) & bit_mask];
+            }
+        });
+
+        // Bucket major exclusive scan keeps the sort stable
+        int32 sum = 0;
+        for (int32 bucket = 0; bucket < bucket_count; ++bucket)
+        {
+            for (int32 chunk = 0; chunk < chunk_count; ++chunk)
+            {
+                int32 n = offsets[chunk * bucket_count + bucket];
+                offsets[chunk * bucket_count + bucket] = sum;
+                sum += n;
+            }
+        }
+
+        ParallelFor(0, chunk_count, [&](int32 chunk) {
+            int32* offset = &offsets[chunk * bucket_count];
+
+            int32 end = std::min(count, (chunk + 1) * chunk_size);
+            for (int32 i = chunk * chunk_size; i < end; ++i)
+            {
+                out[offset[(in[i].code >> low_bit) & bit_mask]++] = in[i];
+            }
+        });
+    }
+}
+
+// Linear BVH builder with optional PLOC refinement
+// https://research.nvidia.com/publication/2012-06_maximizing-parallelism-construction-bvhs-octrees-and-k-d-trees
+// https://meistdan.github.io/publications/ploc/paper.pdf
+BVH::BuildNode* BVH::BuildLinear(
+    ThreadLocal<Allocator>& thread_allocators,
+    std::span<BVHPrimitive> primitive_span,
+    BVHBuildMethod build_method,
+    std::atomic<int32>* total_nodes,
+    std::atomic<int32>* ordered_prims_offset,
+    std::vector<Intersectable*>& ordered_prims
+)
+{
+    const int32 primitive_count = int32(primitive_span.size());
+
+    constexpr int32 min_chunk_size = 4 * 1024;
+    const int32 worker_count = ThreadPool::global_thread_pool->WorkerCount();
+    const int32 chunk_count = std::clamp(primitive_count / min_chunk_size, 1, 8 * worker_count);
+    const int32 chunk_size = (primitive_count + chunk_count - 1) / chunk_count;
+
+    // Compute bounds of primitive centroids
+    std::vector<AABB> chunk_bounds(chunk_count);
+    ParallelFor(0, chunk_count, [&](int32 chunk) {
+        int32 end = std::min(primitive_count, (chunk + 1) * chunk_size);
+        for (int32 i = chunk * chunk_size; i < end; ++i)
+        {
+            chunk_bounds[chunk] = AABB::Union(chunk_bounds[chunk], primitive_span[i].aabb.GetCenter());
+        }
+    });
+
+    AABB centroid_bounds;
+    for (const AABB& bounds : chunk_bounds)
+    {
+        centroid_bounds = AABB::Union(centroid_bounds, bounds);
+    }
+
+    // Compute Morton codes of primitive centroids
+    constexpr int32 morton_bits = 10;
+    constexpr int32 morton_scale = 1 << morton_bits;
+
+    const Vec3 extents = centroid_bounds.GetExtents();
+
+    std::vector<MortonPrimitive> morton_prims(primitive_count);
+    ParallelFor(0, primitive_count, [&](int32 i) {
+        Vec3 offset = primitive_span[i].aabb.GetCenter() - centroid_bounds.min;
+
+        uint32 q[3];
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            q[axis] = extents[axis] > 0 ? uint32(offset[axis] / extents[axis] * morton_scale) : 0;
+        }
+
+        morton_prims[i].code = EncodeMorton3(q[0], q[1], q[2]);
+        morton_prims[i].index = i;
+    });
+
+    RadixSort(&morton_prims, chunk_count);
+
+    // Leaves are stored in [0, primitive_count) in Morton order, followed by internal nodes
+    const int32 node_capacity = 2 * primitive_count - 1;
+
+    Allocator allocator = thread_allocators.Get();
+    BuildNode* build_nodes = allocator.allocate_object<BuildNode>(node_capacity);
+
+    std::vector<int32> subtree_sizes(node_capacity);
+    std::vector<Float> subtree_costs(node_capacity);
+
+    ParallelFor(0, primitive_count, [&](int32 i) {
+        const BVHPrimitive& prim = primitive_span[morton_prims[i].index];
+
+        // Leaves point to the original primitive until they get ordered
+        build_nodes[i].InitLeaf(int32(prim.index), 1, prim.aabb);
+        subtree_sizes[i] = 1;
+        subtree_costs[i] = prim.aabb.GetSurfaceArea();
+    });
+
+    constexpr Float traverse_cost = 0.5f;
+    constexpr int32 max_leaf_size = 8;
+
+    auto init_internal = [&](int32 index, int32 child1, int32 child2) {
+        // Split axis is the one that separates the children the most
+        Vec3 d = build_nodes[child2].aabb.GetCenter() - build_nodes[child1].aabb.GetCenter();
+
+        int32 axis = 0;
+        if (std::abs(d.y) > std::abs(d.x))
+        {
+            axis = 1;
+        }
+        if (std::abs(d.z) > std::abs(d[axis]))
+        {
+            axis = 2;
+        }
+
+        if (d[axis] < 0)
+        {
+            std::swap(child1, child2);
+        }
+
+        BuildNode* node = &build_nodes[index];
+        node->InitInternal(axis, &build_nodes[child1], &build_nodes[child2]);
+
+        Float area = node->aabb.GetSurfaceArea();
+        int32 size = subtree_sizes[child1] + subtree_sizes[child2];
+        Float cost = traverse_cost * area + subtree_costs[child1] + subtree_costs[child2];
+
+        // Collapse small subtrees into a leaf if it's cheaper
+        Float leaf_cost = size * area;
+        if (size <= max_leaf_size && leaf_cost <= cost)
+        {
+            node->count = size;
+            cost = leaf_cost;
+        }
+
+        subtree_sizes[index] = size;
+        subtree_costs[index] = cost;
+    };
+
+    BuildNode* root;
+
+    if (primitive_count == 1)
+    {
+        root = &build_nodes[0];
+    }
+    else if (build_method == BVHBuildMethod::lbvh)
+    {
+        // Emit internal nodes in parallel from the sorted Morton codes
+        auto delta = [&](int32 i, int32 j) -> int32 {
+            if (j < 0 || j >= primitive_count)
+            {
+                return -1;
+            }
+
+            uint32 code_i = morton_prims[i].code;
+            uint32 code_j = morton_prims[j].code;
+            if (code_i == code_j)
+            {
+                // Break ties with the index
+                return 32 + std::countl_zero(uint32(i ^ j));
+            }
+
+            return std::countl_zero(code_i ^ code_j);
+        };
+
+        const int32 internal_count = primitive_count - 1;
+
+        std::vector<int32> parents(node_capacity, -1);
+        std::vector<int32> children(2 * internal_count);
+
+        ParallelFor(0, internal_count, [&](int32 i) {
+            // Direction of the range
+            int32 d = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+
+            // Upper bound of the range length
+            int32 delta_min = delta(i, i - d);
+            int32 l_max = 2;
+            while (delta(i, i + l_max * d) > delta_min)
+            {
+                l_max *= 2;
+            }
+
+            // Find the other end with binary search
+            int32 l = 0;
+            for (int32 t = l_max / 2; t >= 1; t /= 2)
+            {
+                if (delta(i, i + (l + t) * d) > delta_min)
+                {
+                    l += t;
+                }
+            }
+            int32 j = i + l * d;
+
+            // Find the split position with binary search
+            int32 delta_node = delta(i, j);
+            int32 s = 0;
+            for (int32 t = (l + 1) / 2;; t = (t + 1) / 2)
+            {
+                if (delta(i, i + (s + t) * d) > delta_node)
+                {
+                    s += t;
+                }
+
+                if (t == 1)
+                {
+                    break;
+                }
+            }
+            int32 gamma = i + s * d + std::min(d, 0);
+
+            int32 child1 = std::min(i, j) == gamma ? gamma : primitive_count + gamma;
+            int32 child2 = std::max(i, j) == gamma + 1 ? gamma + 1 : primitive_count + gamma + 1;
+
+            children[2 * i + 0] = child1;
+            children[2 * i + 1] = child2;
+            parents[child1] = primitive_count + i;
+            parents[child2] = primitive_count + i;
+        });
+
+        // Compute bounds bottom-up, the last visitor of each node initializes it
+        std::vector<std::atomic<int32>> visits(internal_count);
+        ParallelFor(0, primitive_count, [&](int32 i) {
+            int32 index = parents[i];
+            while (index >= 0)
+            {
+                int32 internal = index - primitive_count;
+                if (visits[internal].fetch_add(1, std::memory_order_acq_rel) == 0)
+                {
+                    // The other child is not ready yet
+                    return;
+                }
+
+                init_internal(index, children[2 * internal + 0], children[2 * internal + 1]);
+                index = parents[index];
+            }
+        });
+
+        root = &build_nodes[primitive_count];
+    }
+    else
+    {
+        // Refine the Morton order with parallel locally-ordered clustering
+        constexpr int32 search_radius = 16;
+
+        std::vector<int32> clusters(primitive_count);
+        std::vector<int32> merged(primitive_count);
+        std::vector<int32> nearest(primitive_count);
+        std::iota(clusters.begin(), clusters.end(), 0);
+
+        std::atomic<int32> next_node(primitive_count);
+        int32 cluster_count = primitive_count;
+
+        while (cluster_count > 1)
+        {
+            // Find the nearest neighbor of each cluster within the search radius
+            ParallelFor(0, cluster_count, [&](int32 i) {
+                const AABB& aabb = build_nodes[clusters[i]].aabb;
+
+                int32 begin = std::max(0, i - search_radius);
+                int32 end = std::min(cluster_count, i + search_radius + 1);
+
+                Float min_area = infinity;
+                int32 min_index = -1;
+                for (int32 j = begin; j < end; ++j)
+                {
+                    if (j == i)
+                    {
+                        continue;
+                    }
+
+                    Float area = AABB::Union(aabb, build_nodes[clusters[j]].aabb).GetSurfaceArea();
+                    if (area < min_area)
+                    {
+                        min_area = area;
+                        min_index = j;
+                    }
+                }
+
+                nearest[i] = min_index;
+            });
+
+            // Merge mutual nearest neighbors
+            ParallelFor(0, cluster_count, [&](int32 i) {
+                int32 j = nearest[i];
+                if (nearest[j] != i)
+                {
+                    merged[i] = clusters[i];
+                }
+                else if (i < j)
+                {
+                    int32 index = next_node.fetch_add(1);
+                    init_internal(index, clusters[i], clusters[j]);
+                    merged[i] = index;
+                }
+                else
+                {
+                    merged[i] = -1;
+                }
+            });
+
+            // Compact remaining clusters
+            const int32 compact_chunk_count = std::clamp(cluster_count / min_chunk_size, 1, chunk_count);
+            const int32 compact_chunk_size = (cluster_count + compact_chunk_count - 1) / compact_chunk_count;
+
+            std::vector<int32> chunk_offsets(compact_chunk_count + 1, 0);
+            ParallelFor(0, compact_chunk_count, [&](int32 chunk) {
+                int32 end = std::min(cluster_count, (chunk + 1) * compact_chunk_size);
+                for (int32 i = chunk * compact_chunk_size; i < end; ++i)
+                {
+                    chunk_offsets[chunk + 1] += int32(merged[i] >= 0);
+                }
+            });
+
+            std::partial_sum(chunk_offsets.begin(), chunk_offsets.end(), chunk_offsets.begin());
+
+            ParallelFor(0, compact_chunk_count, [&](int32 chunk) {
+                int32 offset = chunk_offsets[chunk];
+                int32 end = std::min(cluster_count, (chunk + 1) * compact_chunk_size);
+                for (int32 i = chunk * compact_chunk_size; i < end; ++i)
+                {
+                    if (merged[i] >= 0)
+                    {
+                        clusters[offset++] = merged[i];
+                    }
+                }
+            });
+
+            BulbitAssert(chunk_offsets.back() < cluster_count);
+            cluster_count = chunk_offsets.back();
+        }
+
+        BulbitAssert(next_node == node_capacity);
+        root = &build_nodes[clusters[0]];
+    }
+
+    *total_nodes = AssignLeafPrimitives(root, ordered_prims_offset, ordered_prims);
+
+    return root;
+}
+
+int32 BVH::AssignLeafPrimitives(
+    BuildNode* node, std::atomic<int32>* ordered_prims_offset, std::vector<Intersectable*>& ordered_prims
+)
+{
+    if (node->count == 0)
+    {
+        // Internal node
+        int32 node_count = 1;
+        node_count += AssignLeafPrimitives(node->child1, ordered_prims_offset, ordered_prims);
+        node_count += AssignLeafPrimitives(node->child2, ordered_prims_offset, ordered_prims);
+        return node_count;
+    }
+
+    // Gather primitives of the collapsed subtree
+    int32 offset = ordered_prims_offset->fetch_add(node->count);
+    int32 count = 0;
+
+    GrowableArray<BuildNode*, 64> stack;
+    stack.Emplace(node);
+
+    while (stack.Count() > 0)
+    {
+        BuildNode* n = stack.Pop();
+        if (n->child1)
+        {
+            stack.Emplace(n->child2);
+            stack.Emplace(n->child1);
+        }
+        else
+        {
+            ordered_prims[offset + count++] = primitives[n->offset];
+        }
+    }
+
+    BulbitAssert(count == node->count);
+    node->InitLeaf(offset, count, node->aabb);
+
+    return 1;
+}
+
+} // namespace bulbit
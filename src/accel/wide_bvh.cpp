@@ -0,0 +1,219 @@
+#include "bulbit/wide_bvh.h"
+
+namespace bulbit
+{
+
+template <int32 N>
+WideBVH<N>::WideBVH(const std::vector<Intersectable*>& _primitives, BVHBuildMethod build_method, Float split_budget)
+{
+    // Collapse the binary SAH tree into N-ary nodes
+    BVH bvh(_primitives, build_method, split_budget);
+    aabb = bvh.GetAABB();
+
+    Collapse(bvh, 0);
+
+    primitives = std::move(bvh.primitives);
+}
+
+template <int32 N>
+WideBVH<N>::WideBVH(const BVH& bvh)
+    : primitives{ bvh.primitives }
+    , aabb{ bvh.GetAABB() }
+{
+    Collapse(bvh, 0);
+}
+
+template <int32 N>
+int32 WideBVH<N>::Collapse(const BVH& bvh, int32 binary_index)
+{
+    // Binary nodes that become children of this wide node
+    int32 children[N];
+    int32 child_count = 0;
+
+    const BVH::LinearBVHNode* binary_nodes = bvh.nodes;
+    if (binary_nodes[binary_index].primitive_count > 0)
+    {
+        // Leaf root
+        children[child_count++] = binary_index;
+    }
+    else
+    {
+        children[child_count++] = binary_nodes[binary_index].child_offset;
+        children[child_count++] = binary_nodes[binary_index].child_offset + 1;
+    }
+
+    // Repeatedly open the internal child with the largest surface area
+    while (child_count < N)
+    {
+        int32 best = -1;
+        Float best_area = -1;
+        for (int32 i = 0; i < child_count; ++i)
+        {
+            const BVH::LinearBVHNode& child = binary_nodes[children[i]];
+            if (child.primitive_count == 0 && child.aabb.GetSurfaceArea() > best_area)
+            {
+                best = i;
+                best_area = child.aabb.GetSurfaceArea();
+            }
+        }
+
+        if (best < 0)
+        {
+            break;
+        }
+
+        int32 opened = children[best];
+        children[best] = binary_nodes[opened].child_offset;
+        children[child_count++] = binary_nodes[opened].child_offset + 1;
+    }
+
+    int32 node_index = int32(nodes.size());
+    nodes.emplace_back();
+
+    for (int32 i = 0; i < N; ++i)
+    {
+        if (i >= child_count)
+        {
+            nodes[node_index].SetEmpty(i);
+            continue;
+        }
+
+        const BVH::LinearBVHNode& child = binary_nodes[children[i]];
+        if (child.primitive_count > 0)
+        {
+            nodes[node_index].SetChild(i, child.aabb, child.primitives_offset, child.primitive_count);
+        }
+        else
+        {
+            // Recursion may reallocate the node array
+            int32 child_index = Collapse(bvh, children[i]);
+            nodes[node_index].SetChild(i, child.aabb, child_index, 0);
+        }
+    }
+
+    return node_index;
+}
+
+template <int32 N>
+bool WideBVH<N>::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
+{
+    struct Callback
+    {
+        Intersection* closest;
+        bool hit_closest;
+        Float t;
+
+        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, const Intersectable* object)
+        {
+            Intersection isect;
+            bool hit = object->Intersect(&isect, ray, t_min, t_max);
+
+            if (hit)
+            {
+                BulbitAssert(isect.t <= t);
+                hit_closest = true;
+                t = isect.t;
+                *closest = isect;
+            }
+
+            // Keep traverse with smaller bounds
+            return t;
+        }
+    } callback;
+
+    callback.closest = isect;
+    callback.hit_closest = false;
+    callback.t = t_max;
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_closest;
+}
+
+template <int32 N>
+bool WideBVH<N>::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
+{
+    struct Callback
+    {
+        bool hit_any;
+
+        Float RayCastCallback(const Ray& ray, Float t_min, Float t_max, Intersectable* object)
+        {
+            bool hit = object->IntersectAny(ray, t_min, t_max);
+
+            if (hit)
+            {
+                hit_any = true;
+
+                // Stop traversal
+                return t_min;
+            }
+
+            return t_max;
+        }
+    } callback;
+
+    callback.hit_any = false;
+
+    RayCast(ray, t_min, t_max, &callback);
+
+    return callback.hit_any;
+}
+
+template <int32 N>
+AABB WideBVH<N>::GetAABB() const
+{
+    return aabb;
+}
+
+template <int32 N>
+Float WideBVH<N>::GetSAHCost() const
+{
+    constexpr Float traverse_cost = 0.5f;
+
+    Float cost = traverse_cost * aabb.GetSurfaceArea();
+    for (const Node& node : nodes)
+    {
+        for (int32 i = 0; i < N; ++i)
+        {
+            if (node.offset[i] < 0)
+            {
+                // Empty slot
+                continue;
+            }
+
+            AABB child(
+                Point3(node.bounds[0][0][i], node.bounds[0][1][i], node.bounds[0][2][i]),
+                Point3(node.bounds[1][0][i], node.bounds[1][1][i], node.bounds[1][2][i])
+            );
+
+            if (node.count[i] > 0)
+            {
+                cost += node.count[i] * child.GetSurfaceArea();
+            }
+            else
+            {
+                cost += traverse_cost * child.GetSurfaceArea();
+            }
+        }
+    }
+
+    return cost / aabb.GetSurfaceArea();
+}
+
+template <int32 N>
+int32 WideBVH<N>::GetNodeCount() const
+{
+    return int32(nodes.size());
+}
+
+template <int32 N>
+size_t WideBVH<N>::GetMemoryUsage() const
+{
+    return sizeof(WideBVH) + nodes.size() * sizeof(Node) + primitives.size() * sizeof(Intersectable*);
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+} // namespace bulbit
@@ -67,4 +67,32 @@ Mesh::Mesh(const std::vector<MeshVertex>& vertices, std::vector<int32> _indices,
     triangle_count = int32(indices.size() / 3);
 }
 
+void Mesh::SetPositions(std::span<const Point3> _positions, const Mat4& transform)
+{
+    BulbitAssert(_positions.size() == positions.size());
+
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        Vec4 vP = Mul(transform, Vec4(_positions[i], 1));
+        positions[i].Set(vP.x, vP.y, vP.z);
+    }
+}
+
+void Mesh::SetNormals(std::span<const Vec3> _normals, std::span<const Vec3> _tangents, const Mat4& transform)
+{
+    BulbitAssert(_normals.size() == normals.size());
+    BulbitAssert(_tangents.size() == tangents.size());
+
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        Vec4 vN = Mul(transform, Vec4(_normals[i], 0));
+        Vec4 vT = Mul(transform, Vec4(_tangents[i], 0));
+        vN.Normalize();
+        vT.Normalize();
+
+        normals[i].Set(vN.x, vN.y, vN.z);
+        tangents[i].Set(vT.x, vT.y, vT.z);
+    }
+}
+
 } // namespace bulbit
\ No newline at end of file
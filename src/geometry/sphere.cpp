@@ -114,6 +114,41 @@ bool Sphere::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
     return true;
 }
 
+bool Sphere::IntersectAny(AnyHit* hit, const Ray& ray, Float t_min, Float t_max) const
+{
+    Ray r = MulT(transform, ray);
+
+    Point3 oc = r.o;
+    Float a = Length2(r.d);
+    Float half_b = Dot(oc, r.d);
+    Float c = Length2(oc) - radius * radius;
+
+    Float discriminant = half_b * half_b - a * c;
+    if (discriminant < 0)
+    {
+        return false;
+    }
+    Float sqrt_d = std::sqrt(discriminant);
+
+    Float root = (-half_b - sqrt_d) / a;
+    if (root < t_min || t_max < root)
+    {
+        root = (-half_b + sqrt_d) / a;
+        if (root < t_min || t_max < root)
+        {
+            return false;
+        }
+    }
+
+    Point3 point = r.At(root);
+
+    hit->t = root;
+    hit->point = Mul(transform, point);
+    hit->uv = ComputeTexCoord(Normalize(point / radius));
+
+    return true;
+}
+
 ShapeSample Sphere::Sample(Point2 u) const
 {
     ShapeSample sample;
@@ -51,6 +51,51 @@ AABB Triangle::GetAABB() const
     return AABB(min, max);
 }
 
+AABB Triangle::GetClippedAABB(int32 axis, Float min, Float max) const
+{
+    const Vec3 aabb_offset{ epsilon * 10 };
+
+    const Point3 p[3] = { mesh->positions[v[0]], mesh->positions[v[1]], mesh->positions[v[2]] };
+
+    // Bound the polygon obtained by clipping the triangle with the slab
+    AABB aabb;
+    for (int32 i = 0; i < 3; ++i)
+    {
+        const Point3& p0 = p[i];
+        const Point3& p1 = p[(i + 1) % 3];
+
+        if (p0[axis] >= min && p0[axis] <= max)
+        {
+            aabb = AABB::Union(aabb, p0);
+        }
+
+        for (Float plane : { min, max })
+        {
+            // Edge crosses the plane
+            if ((p0[axis] < plane && p1[axis] > plane) || (p0[axis] > plane && p1[axis] < plane))
+            {
+                Point3 q = Lerp(p0, p1, (plane - p0[axis]) / (p1[axis] - p0[axis]));
+                q[axis] = plane;
+                aabb = AABB::Union(aabb, q);
+            }
+        }
+    }
+
+    if (aabb.min[axis] > aabb.max[axis])
+    {
+        // Triangle does not overlap the slab
+        return aabb;
+    }
+
+    return AABB(aabb.min - aabb_offset, aabb.max + aabb_offset);
+}
+
+uint64 Triangle::GetGeometryHash() const
+{
+    const Point3 p[3] = { mesh->positions[v[0]], mesh->positions[v[1]], mesh->positions[v[2]] };
+    return HashBuffer(p, sizeof(p));
+}
+
 // Möller-Trumbore algorithm
 bool Triangle::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float t_max) const
 {
@@ -97,16 +142,25 @@ bool Triangle::Intersect(Intersection* isect, const Ray& ray, Float t_min, Float
     }
 
     // Found intersection
-    Float w = 1 - u - v;
+    SetIntersection(isect, ray, t, u, v);
+
+    return true;
+}
+
+void Triangle::SetIntersection(Intersection* isect, const Ray& ray, Float t, Float tu, Float tv) const
+{
+    const Point3& p0 = mesh->positions[v[0]];
+    const Point3& p1 = mesh->positions[v[1]];
+    const Point3& p2 = mesh->positions[v[2]];
+
+    Float tw = 1 - tu - tv;
 
     isect->t = t;
     isect->point = ray.At(t);
-    isect->uv = GetTexCoord(u, v, w);
-
-    Vec3 normal = Normalize(Cross(e1, e2));
-    SetFaceNormal(isect, ray.d, normal, GetNormal(u, v, w), GetTangent(u, v, w));
+    isect->uv = GetTexCoord(tu, tv, tw);
 
-    return true;
+    Vec3 normal = Normalize(Cross(p1 - p0, p2 - p0));
+    SetFaceNormal(isect, ray.d, normal, GetNormal(tu, tv, tw), GetTangent(tu, tv, tw));
 }
 
 bool Triangle::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
@@ -156,6 +210,57 @@ bool Triangle::IntersectAny(const Ray& ray, Float t_min, Float t_max) const
     return true;
 }
 
+bool Triangle::IntersectAny(AnyHit* hit, const Ray& ray, Float t_min, Float t_max) const
+{
+    const Point3& p0 = mesh->positions[v[0]];
+    const Point3& p1 = mesh->positions[v[1]];
+    const Point3& p2 = mesh->positions[v[2]];
+
+    Vec3 e1 = p1 - p0;
+    Vec3 e2 = p2 - p0;
+
+    Vec3 d = ray.d;
+    Float l = d.Normalize();
+    Vec3 pvec = Cross(d, e2);
+
+    Float det = Dot(e1, pvec);
+
+    // Ray and triangle are parallel
+    if (std::fabs(det) < epsilon)
+    {
+        return false;
+    }
+
+    Float invDet = 1 / det;
+
+    Vec3 tvec = ray.o - p0;
+    Float u = Dot(tvec, pvec) * invDet;
+    if (u < 0 || u > 1)
+    {
+        return false;
+    }
+
+    Vec3 qvec = Cross(tvec, e1);
+    Float v = Dot(d, qvec) * invDet;
+    if (v < 0 || u + v > 1)
+    {
+        return false;
+    }
+
+    Float t = Dot(e2, qvec) * invDet / l;
+    if (t < t_min || t > t_max)
+    {
+        return false;
+    }
+
+    // Only texture coordinates are interpolated, normals and tangents are left out
+    hit->t = t;
+    hit->point = ray.At(t);
+    hit->uv = GetTexCoord(u, v, 1 - u - v);
+
+    return true;
+}
+
 ShapeSample Triangle::Sample(Point2 u0) const
 {
     const Point3& p0 = mesh->positions[v[0]];
@@ -11,7 +11,7 @@ AlbedoIntegrator::AlbedoIntegrator(const Intersectable* accel, std::vector<Light
 {
 }
 
-Spectrum AlbedoIntegrator::Li(const Ray& ray, const Medium* medium, Sampler& sampler) const
+Spectrum AlbedoIntegrator::Li(const Ray& ray, const Medium* medium, PrimaryHit* primary_hit, Sampler& sampler) const
 {
     BulbitNotUsed(medium);
     BulbitNotUsed(sampler);
@@ -19,7 +19,7 @@ Spectrum AlbedoIntegrator::Li(const Ray& ray, const Medium* medium, Sampler& sam
     Spectrum L(0);
 
     Intersection isect;
-    if (!Intersect(&isect, ray, Ray::epsilon, infinity))
+    if (!Intersect(&isect, ray, Ray::epsilon, infinity, primary_hit))
     {
         for (Light* light : infinite_lights)
         {
@@ -11,12 +11,12 @@ AOIntegrator::AOIntegrator(const Intersectable* accel, std::vector<Light*> light
 {
 }
 
-Spectrum AOIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
+Spectrum AOIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, PrimaryHit* primary_hit, Sampler& sampler) const
 {
     BulbitNotUsed(primary_medium);
 
     Intersection isect;
-    if (!Intersect(&isect, primary_ray, Ray::epsilon, infinity))
+    if (!Intersect(&isect, primary_ray, Ray::epsilon, infinity, primary_hit))
     {
         return Spectrum::black;
     }
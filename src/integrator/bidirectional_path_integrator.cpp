@@ -130,7 +130,7 @@ int32 BiDirectionalPathIntegrator::SampleLightPath(Vertex* path, Sampler& sample
 }
 
 Spectrum BiDirectionalPathIntegrator::L(
-    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, Film& film, Sampler& sampler
+    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
 ) const
 {
     BulbitNotUsed(primary_medium);
@@ -163,7 +163,7 @@ Spectrum BiDirectionalPathIntegrator::L(
 
             if (t == 1)
             {
-                film.AddSplat(p_raster, L_path);
+                film_tile.AddSplat(p_raster, L_path);
             }
             else
             {
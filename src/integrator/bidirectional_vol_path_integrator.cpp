@@ -133,7 +133,7 @@ int32 BiDirectionalVolPathIntegrator::SampleLightPath(Vertex* path, int32 wavele
 }
 
 Spectrum BiDirectionalVolPathIntegrator::L(
-    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, Film& film, Sampler& sampler
+    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
 ) const
 {
     BufferResource path_buffer(2 * sizeof(Vertex) * (max_bounces + 2));
@@ -167,7 +167,7 @@ Spectrum BiDirectionalVolPathIntegrator::L(
 
             if (t == 1)
             {
-                film.AddSplat(p_raster, L_path);
+                film_tile.AddSplat(p_raster, L_path);
             }
             else
             {
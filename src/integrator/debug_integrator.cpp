@@ -8,13 +8,15 @@ DebugIntegrator::DebugIntegrator(const Intersectable* accel, std::vector<Light*>
 {
 }
 
-Spectrum DebugIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
+Spectrum DebugIntegrator::Li(
+    const Ray& primary_ray, const Medium* primary_medium, PrimaryHit* primary_hit, Sampler& sampler
+) const
 {
     BulbitNotUsed(primary_medium);
     BulbitNotUsed(sampler);
 
     Intersection isect;
-    if (!Intersect(&isect, primary_ray, Ray::epsilon, infinity))
+    if (!Intersect(&isect, primary_ray, Ray::epsilon, infinity, primary_hit))
     {
         return Spectrum::black;
     }
@@ -4,16 +4,17 @@
 #include "bulbit/async_job.h"
 #include "bulbit/camera.h"
 #include "bulbit/film.h"
+#include "bulbit/material.h"
 #include "bulbit/media.h"
 #include "bulbit/microfacet.h"
 #include "bulbit/parallel_for.h"
 #include "bulbit/progresses.h"
-#include "bulbit/sampler.h"
+#include "bulbit/samplers.h"
 
 namespace bulbit
 {
 
-Integrator* Integrator::Create(
+static Integrator* CreateIntegrator(
     Allocator& alloc,
     const IntegratorInfo& ii,
     const Intersectable* accel,
@@ -99,11 +100,34 @@ Integrator* Integrator::Create(
     case IntegratorType::debug:
         return alloc.new_object<DebugIntegrator>(accel, lights, sampler);
 
+    case IntegratorType::wavefront_path:
+        return alloc.new_object<WavefrontPathIntegrator>(accel, lights, sampler, max_bounces, rr_min_bounces, ii.regularize_bsdf);
+
     default:
         return nullptr;
     }
 }
 
+Integrator* Integrator::Create(
+    Allocator& alloc,
+    const IntegratorInfo& ii,
+    const Intersectable* accel,
+    const std::vector<Light*>& lights,
+    const Sampler* sampler
+)
+{
+    Integrator* integrator = CreateIntegrator(alloc, ii, accel, lights, sampler);
+
+    if (UniDirectionalRayIntegrator* uni = dynamic_cast<UniDirectionalRayIntegrator*>(integrator))
+    {
+        uni->SetProgressive(ii.pass_spp, ii.time_limit, ii.snapshot_interval);
+        uni->SetAdaptiveSampling(ii.adaptive_threshold);
+        uni->SetHitSorting(ii.sort_hits);
+    }
+
+    return integrator;
+}
+
 Integrator::Integrator(const Intersectable* accel, std::vector<Light*> lights, std::unique_ptr<LightSampler> l_sampler)
     : accel{ accel }
     , all_lights{ std::move(lights) }
@@ -159,49 +183,331 @@ UniDirectionalRayIntegrator::UniDirectionalRayIntegrator(
 {
 }
 
+void UniDirectionalRayIntegrator::SetProgressive(int32 _pass_spp, Float _time_limit, Float _snapshot_interval)
+{
+    pass_spp = _pass_spp;
+    time_limit = _time_limit;
+    snapshot_interval = _snapshot_interval;
+}
+
+// Splits the sample budget of the next pass among the pixels in proportion to their relative error
+// Returns false if every pixel is below the error threshold
+static bool DistributeAdaptiveSamples(
+    const Film& film, Point2i resolution, Float threshold, int64 budget, int32 samples_per_pass, std::vector<int32>* pass_samples
+)
+{
+    // Errors above 100% are all equally far from converged, this also covers pixels with too few samples to tell
+    constexpr Float max_error = 1;
+
+    // Samples of a pixel in one pass are limited so that a few outliers can't drain the budget
+    const int32 max_pass_samples = 4 * samples_per_pass;
+
+    Image1 error = film.GetRelativeErrorImage();
+
+    // Each pixel takes the largest error of its neighborhood, the error estimated from a few samples is unreliable
+    // and a pixel whose warmup samples happened to agree shouldn't stop while its neighbors are still noisy
+    std::vector<Float> pixel_errors(size_t(resolution.x) * resolution.y);
+    ParallelFor(0, resolution.y, [&](int32 y) {
+        for (int32 x = 0; x < resolution.x; ++x)
+        {
+            Float e = 0;
+            for (int32 j = std::max(y - 1, 0); j <= std::min(y + 1, resolution.y - 1); ++j)
+            {
+                for (int32 i = std::max(x - 1, 0); i <= std::min(x + 1, resolution.x - 1); ++i)
+                {
+                    e = std::max(e, std::min(error(i, j), max_error));
+                }
+            }
+
+            pixel_errors[y * resolution.x + x] = e > threshold ? e : 0;
+        }
+    });
+
+    double error_sum = 0;
+    for (Float e : pixel_errors)
+    {
+        error_sum += e;
+    }
+
+    if (error_sum == 0)
+    {
+        return false;
+    }
+
+    int64 active_count = 0;
+    for (Float e : pixel_errors)
+    {
+        active_count += e > 0;
+    }
+
+    // Too many noisy pixels for the budget, the noisiest ones take a single sample each
+    if (active_count > budget)
+    {
+        std::vector<int32> order(pixel_errors.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::nth_element(order.begin(), order.begin() + budget, order.end(), [&](int32 a, int32 b) {
+            return pixel_errors[a] > pixel_errors[b];
+        });
+
+        std::fill(pass_samples->begin(), pass_samples->end(), 0);
+        for (int64 i = 0; i < budget; ++i)
+        {
+            (*pass_samples)[order[i]] = 1;
+        }
+
+        return true;
+    }
+
+    // Every pixel above the threshold gets one sample and shares the rest of the budget by its error,
+    // rounding down keeps the pass within the budget
+    const int64 shared_budget = budget - active_count;
+    int64 total = 0;
+    for (size_t i = 0; i < pixel_errors.size(); ++i)
+    {
+        if (pixel_errors[i] == 0)
+        {
+            (*pass_samples)[i] = 0;
+            continue;
+        }
+
+        double count = 1 + std::floor(shared_budget * (pixel_errors[i] / error_sum));
+        (*pass_samples)[i] = int32(std::min<double>(count, max_pass_samples));
+        total += (*pass_samples)[i];
+    }
+
+    // Floating point rounding may still overshoot by a few samples
+    for (size_t i = 0; total > budget && i < pass_samples->size(); ++i)
+    {
+        if ((*pass_samples)[i] > 1)
+        {
+            --(*pass_samples)[i];
+            --total;
+        }
+    }
+
+    return true;
+}
+
+void UniDirectionalRayIntegrator::SetAdaptiveSampling(Float threshold)
+{
+    adaptive_threshold = threshold;
+}
+
+void UniDirectionalRayIntegrator::SetHitSorting(bool enabled)
+{
+    sort_hits = enabled;
+}
+
 Rendering* UniDirectionalRayIntegrator::Render(Allocator& alloc, const Camera* camera)
 {
+    using clock = std::chrono::steady_clock;
+
     Point2i resolution = camera->GetScreenResolution();
 
     const int32 spp = sampler_prototype->samples_per_pixel;
-    const int32 tile_size = 16;
+    constexpr int32 tile_size = 16;
+
+    const bool adaptive = adaptive_threshold > 0;
+    constexpr int32 adaptive_pass_spp = 16;
 
-    Point2i num_tiles = (resolution + (tile_size - 1)) / tile_size;
-    int32 tile_count = num_tiles.x * num_tiles.y;
+    // All samples of a tile are taken at once unless rendering progressively or adaptively
+    const int32 samples_per_pass = std::min(pass_spp > 0 ? pass_spp : (adaptive ? adaptive_pass_spp : spp), spp);
+    const int32 pass_count = std::max(1, (spp + samples_per_pass - 1) / samples_per_pass);
 
-    SinglePhaseRendering* progress = alloc.new_object<SinglePhaseRendering>(camera, size_t(tile_count));
+    int32 pixel_count = resolution.x * resolution.y;
+
+    // Progress is counted in samples since the adaptive passes vary in size
+    SinglePhaseRendering* progress = alloc.new_object<SinglePhaseRendering>(camera, size_t(pixel_count) * spp);
     progress->job = RunAsync([=, this]() {
-        ParallelFor2D(
-            resolution,
-            [&](AABB2i tile) {
-                // Thread local sampler for current tile
-                int8 mem[64];
-                BufferResource buffer(mem, sizeof(mem));
-                Allocator alloc(&buffer);
-                Sampler* sampler = sampler_prototype->Clone(alloc);
+        const clock::time_point start = clock::now();
+        clock::time_point last_snapshot = start;
+
+        auto seconds_since = [](clock::time_point t) { return std::chrono::duration<double>(clock::now() - t).count(); };
 
-                for (Point2i pixel : tile)
+        std::atomic<bool> expired = false;
+
+        // Samples taken so far and samples of the current pass of each pixel, only used for adaptive sampling
+        std::vector<int32> pixel_samples;
+        std::vector<int32> pass_samples;
+        int64 remaining_samples = int64(pixel_count) * spp;
+
+        if (adaptive)
+        {
+            pixel_samples.resize(pixel_count, 0);
+            pass_samples.resize(pixel_count, samples_per_pass);
+        }
+
+        for (int32 pass = 0; remaining_samples > 0 && !expired.load(std::memory_order_relaxed); ++pass)
+        {
+            if (!adaptive && pass == pass_count)
+            {
+                break;
+            }
+
+            if (adaptive && pass > 0)
+            {
+                int64 budget = std::min<int64>(remaining_samples, int64(pixel_count) * samples_per_pass);
+                if (!DistributeAdaptiveSamples(
+                        progress->film, resolution, adaptive_threshold, budget, samples_per_pass, &pass_samples
+                    ))
                 {
-                    for (int32 sample = 0; sample < spp; ++sample)
+                    // Every pixel has converged
+                    break;
+                }
+            }
+
+            // First sample index and number of samples of the pixel in this pass
+            auto get_pass_samples = [&](Point2i pixel) -> std::pair<int32, int32> {
+                if (adaptive)
+                {
+                    int32 index = pixel.y * resolution.x + pixel.x;
+                    return { pixel_samples[index], pass_samples[index] };
+                }
+
+                int32 sample_begin = pass * samples_per_pass;
+                return { sample_begin, std::min(samples_per_pass, spp - sample_begin) };
+            };
+
+            std::atomic<int64> pass_sample_count = 0;
+
+            ParallelFor2D(
+                resolution,
+                [&](AABB2i tile) {
+                    // Tiles not started before the deadline are skipped, the film averages each pixel by its own count
+                    // The first pass always completes so that every pixel has a sample
+                    if (pass > 0 &&
+                        (expired.load(std::memory_order_relaxed) || (time_limit > 0 && seconds_since(start) >= time_limit)))
+                    {
+                        expired.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+
+                    // Thread local sampler for current tile
+                    int8 mem[64];
+                    BufferResource buffer(mem, sizeof(mem));
+                    Allocator alloc(&buffer);
+                    Sampler* sampler = sampler_prototype->Clone(alloc);
+                    FilmTile film_tile(&progress->film, tile);
+
+                    int32 max_samples = 0;
+                    int32 tile_sample_count = 0;
+                    for (Point2i pixel : tile)
                     {
-                        sampler->StartPixelSample(pixel, sample);
+                        int32 count = get_pass_samples(pixel).second;
+                        max_samples = std::max(max_samples, count);
+                        tile_sample_count += count;
+                    }
+
+                    // The sample loop is instantiated for each sampler type so that the per sample setup calls the sampler
+                    // directly. Li still takes the sampler through the base class, so the calls made per bounce stay virtual
+                    sampler->Dispatch([&](auto sampler) {
+                        // Camera rays of the whole tile are traced together, one sample per pixel at a time
+                        PrimaryRay primary_rays[tile_size * tile_size];
+                        Ray rays[tile_size * tile_size];
+                        Intersection isects[tile_size * tile_size];
+                        bool hits[tile_size * tile_size];
+                        Point2i ray_pixels[tile_size * tile_size];
+                        int32 ray_samples[tile_size * tile_size];
+
+                        for (int32 sample = 0; sample < max_samples; ++sample)
+                        {
+                            int32 ray_count = 0;
+                            for (Point2i pixel : tile)
+                            {
+                                auto [sample_begin, sample_count] = get_pass_samples(pixel);
+                                if (sample >= sample_count)
+                                {
+                                    continue;
+                                }
+
+                                ray_pixels[ray_count] = pixel;
+                                ray_samples[ray_count] = sample_begin + sample;
+
+                                sampler->StartPixelSample(pixel, ray_samples[ray_count]);
+
+                                Float u[4];
+                                sampler->NextND(u);
+
+                                camera->SampleRay(&primary_rays[ray_count], pixel, { u[0], u[1] }, { u[2], u[3] });
+                                rays[ray_count] = primary_rays[ray_count].ray;
+                                ++ray_count;
+                            }
+
+                            accel->IntersectN(
+                                std::span(isects, ray_count), std::span(hits, ray_count), std::span(rays, ray_count),
+                                Ray::epsilon, infinity
+                            );
+
+                            // Shading the hits grouped by material keeps the code and textures of one material hot in cache,
+                            // the pixels of a material stay in screen order
+                            int32 order[tile_size * tile_size];
+                            std::iota(order, order + ray_count, 0);
+
+                            if (sort_hits)
+                            {
+                                const Material* materials[tile_size * tile_size];
+                                for (int32 i = 0; i < ray_count; ++i)
+                                {
+                                    materials[i] = hits[i] ? isects[i].primitive->GetMaterial() : nullptr;
+                                }
+
+                                auto key = [&](int32 i) {
+                                    return std::tuple(materials[i] ? materials[i]->type_index : -1, materials[i], i);
+                                };
+
+                                std::sort(order, order + ray_count, [&](int32 a, int32 b) { return key(a) < key(b); });
+                            }
+
+                            for (int32 k = 0; k < ray_count; ++k)
+                            {
+                                int32 i = order[k];
+
+                                // Replay the camera sample so that Li continues the same sample sequence
+                                Float u[4];
+                                sampler->StartPixelSample(ray_pixels[i], ray_samples[i]);
+                                sampler->NextND(u);
+
+                                PrimaryHit primary_hit{ true, hits[i], &isects[i] };
+
+                                const PrimaryRay& primary_ray = primary_rays[i];
+                                Spectrum L = Li(primary_ray.ray, camera->GetMedium(), &primary_hit, *sampler);
+                                if (!L.IsNullish())
+                                {
+                                    film_tile.AddSample(ray_pixels[i], primary_ray.weight * L);
+                                }
+                            }
+                        }
+                    });
 
-                        PrimaryRay primary_ray;
-                        camera->SampleRay(&primary_ray, pixel, sampler->Next2D(), sampler->Next2D());
+                    progress->film.MergeTile(&film_tile);
 
-                        Spectrum L = Li(primary_ray.ray, camera->GetMedium(), *sampler);
-                        if (!L.IsNullish())
+                    if (adaptive)
+                    {
+                        for (Point2i pixel : tile)
                         {
-                            progress->film.AddSample(pixel, primary_ray.weight * L);
+                            int32 index = pixel.y * resolution.x + pixel.x;
+                            pixel_samples[index] += pass_samples[index];
                         }
                     }
-                }
 
-                progress->work_dones.fetch_add(1, std::memory_order_relaxed);
-            },
-            tile_size
-        );
+                    pass_sample_count.fetch_add(tile_sample_count, std::memory_order_relaxed);
+                    progress->work_dones.fetch_add(tile_sample_count, std::memory_order_relaxed);
+                },
+                tile_size
+            );
+
+            remaining_samples -= pass_sample_count.load();
+
+            // The snapshot is taken between passes so that it never sees a half merged tile
+            if (snapshot_interval > 0 && remaining_samples > 0 && seconds_since(last_snapshot) >= snapshot_interval)
+            {
+                progress->PublishSnapshot(progress->film.GetRenderedImage());
+                last_snapshot = clock::now();
+            }
+        }
 
+        // Adaptive and time limited renders may finish before every planned sample is taken
+        progress->work_dones.store(progress->works, std::memory_order_relaxed);
         progress->done.store(true, std::memory_order_release);
         return true;
     });
@@ -224,10 +530,9 @@ Rendering* BiDirectionalRayIntegrator::Render(Allocator& alloc, const Camera* ca
     const int32 spp = sampler_prototype->samples_per_pixel;
     const int32 tile_size = 16;
 
-    Point2i num_tiles = (resolution + (tile_size - 1)) / tile_size;
-    int32 tile_count = num_tiles.x * num_tiles.y;
+    int32 pixel_count = resolution.x * resolution.y;
 
-    SinglePhaseRendering* progress = alloc.new_object<SinglePhaseRendering>(camera, size_t(tile_count));
+    SinglePhaseRendering* progress = alloc.new_object<SinglePhaseRendering>(camera, size_t(pixel_count));
     progress->job = RunAsync([=, this]() {
         ParallelFor2D(
             resolution,
@@ -237,25 +542,33 @@ Rendering* BiDirectionalRayIntegrator::Render(Allocator& alloc, const Camera* ca
                 BufferResource buffer(mem, sizeof(mem));
                 Allocator alloc(&buffer);
                 Sampler* sampler = sampler_prototype->Clone(alloc);
+                FilmTile film_tile(&progress->film, tile);
 
-                for (Point2i pixel : tile)
-                {
-                    for (int32 sample = 0; sample < spp; ++sample)
+                sampler->Dispatch([&](auto sampler) {
+                    for (Point2i pixel : tile)
                     {
-                        sampler->StartPixelSample(pixel, sample);
+                        for (int32 sample = 0; sample < spp; ++sample)
+                        {
+                            sampler->StartPixelSample(pixel, sample);
 
-                        PrimaryRay primary_ray;
-                        camera->SampleRay(&primary_ray, pixel, sampler->Next2D(), sampler->Next2D());
+                            Float u[4];
+                            sampler->NextND(u);
 
-                        Spectrum Li = L(primary_ray.ray, camera->GetMedium(), camera, progress->film, *sampler);
-                        if (!Li.IsNullish())
-                        {
-                            progress->film.AddSample(pixel, primary_ray.weight * Li);
+                            PrimaryRay primary_ray;
+                            camera->SampleRay(&primary_ray, pixel, { u[0], u[1] }, { u[2], u[3] });
+
+                            Spectrum Li = L(primary_ray.ray, camera->GetMedium(), camera, film_tile, *sampler);
+                            if (!Li.IsNullish())
+                            {
+                                film_tile.AddSample(pixel, primary_ray.weight * Li);
+                            }
                         }
                     }
-                }
+                });
+
+                progress->film.MergeTile(&film_tile);
 
-                progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
             },
             tile_size
         );
@@ -21,7 +21,7 @@ LightPathIntegrator::LightPathIntegrator(
 }
 
 Spectrum LightPathIntegrator::L(
-    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, Film& film, Sampler& sampler
+    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
 ) const
 {
     BulbitNotUsed(primary_ray);
@@ -60,7 +60,7 @@ Spectrum LightPathIntegrator::L(
                              AbsDot(camera_sample.normal, camera_sample.wi) * camera_sample.Wi /
                              (sampled_light.pmf * camera_sample.pdf * light_sample.pdf_p);
 
-                film.AddSplat(camera_sample.p_raster, L);
+                film_tile.AddSplat(camera_sample.p_raster, L);
             }
         }
     }
@@ -109,7 +109,7 @@ Spectrum LightPathIntegrator::L(
                 Spectrum L = beta * camera_sample.Wi * bsdf.f(wo, wi, TransportDirection::ToCamera) *
                              AbsDot(isect.shading.normal, wi) / camera_sample.pdf;
 
-                film.AddSplat(camera_sample.p_raster, L);
+                film_tile.AddSplat(camera_sample.p_raster, L);
             }
         }
 
@@ -21,7 +21,7 @@ LightVolPathIntegrator::LightVolPathIntegrator(
 }
 
 Spectrum LightVolPathIntegrator::L(
-    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, Film& film, Sampler& sampler
+    const Ray& primary_ray, const Medium* primary_medium, const Camera* camera, FilmTile& film_tile, Sampler& sampler
 ) const
 {
     BulbitNotUsed(primary_ray);
@@ -61,7 +61,7 @@ Spectrum LightVolPathIntegrator::L(
                              AbsDot(camera_sample.normal, camera_sample.wi) * camera_sample.Wi /
                              (sampled_light.pmf * camera_sample.pdf * light_sample.pdf_p);
 
-                film.AddSplat(camera_sample.p_raster, L);
+                film_tile.AddSplat(camera_sample.p_raster, L);
             }
         }
     }
@@ -126,7 +126,7 @@ Spectrum LightVolPathIntegrator::L(
                                 r_u *= T_maj * ms.sigma_a / pdf;
 
                                 Spectrum L = camera_sample.Wi * V * ms.Le * beta / r_u.Average();
-                                film.AddSplat(camera_sample.p_raster, L / camera_sample.pdf);
+                                film_tile.AddSplat(camera_sample.p_raster, L / camera_sample.pdf);
                             }
                         }
 
@@ -155,7 +155,7 @@ Spectrum LightVolPathIntegrator::L(
                             if (Spectrum V = Tr(this, p, camera_sample.p_aperture, medium, wavelength); !V.IsBlack())
                             {
                                 Spectrum L = camera_sample.Wi * V * ms.phase->p(wo, wi) * beta / r_u.Average();
-                                film.AddSplat(camera_sample.p_raster, L / camera_sample.pdf);
+                                film_tile.AddSplat(camera_sample.p_raster, L / camera_sample.pdf);
                             }
                         }
 
@@ -249,7 +249,7 @@ Spectrum LightVolPathIntegrator::L(
                 Spectrum L = camera_sample.Wi * V * bsdf.f(wo, wi, TransportDirection::ToCamera) *
                              AbsDot(isect.shading.normal, wi) * beta / r_u.Average();
 
-                film.AddSplat(camera_sample.p_raster, L / camera_sample.pdf);
+                film_tile.AddSplat(camera_sample.p_raster, L / camera_sample.pdf);
             }
         }
 
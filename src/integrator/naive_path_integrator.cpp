@@ -16,7 +16,9 @@ NaivePathIntegrator::NaivePathIntegrator(
 {
 }
 
-Spectrum NaivePathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
+Spectrum NaivePathIntegrator::Li(
+    const Ray& primary_ray, const Medium* primary_medium, PrimaryHit* primary_hit, Sampler& sampler
+) const
 {
     BulbitNotUsed(primary_medium);
     // return Li(ray, sampler, 0);
@@ -29,7 +31,7 @@ Spectrum NaivePathIntegrator::Li(const Ray& primary_ray, const Medium* primary_m
     while (true)
     {
         Intersection isect;
-        if (!Intersect(&isect, ray, Ray::epsilon, infinity))
+        if (!Intersect(&isect, ray, Ray::epsilon, infinity, primary_hit))
         {
             for (Light* light : infinite_lights)
             {
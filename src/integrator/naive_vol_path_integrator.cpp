@@ -18,7 +18,9 @@ NaiveVolPathIntegrator::NaiveVolPathIntegrator(
 {
 }
 
-Spectrum NaiveVolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
+Spectrum NaiveVolPathIntegrator::Li(
+    const Ray& primary_ray, const Medium* primary_medium, PrimaryHit* primary_hit, Sampler& sampler
+) const
 {
     int32 bounce = 0;
     Spectrum L(0), beta(1);
@@ -37,7 +39,7 @@ Spectrum NaiveVolPathIntegrator::Li(const Ray& primary_ray, const Medium* primar
 
         Vec3 wo = Normalize(-ray.d);
         Intersection isect;
-        bool found_intersection = Intersect(&isect, ray, Ray::epsilon, infinity);
+        bool found_intersection = Intersect(&isect, ray, Ray::epsilon, infinity, primary_hit);
 
         if (medium)
         {
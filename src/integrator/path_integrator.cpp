@@ -23,7 +23,7 @@ PathIntegrator::PathIntegrator(
 {
 }
 
-Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
+Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, PrimaryHit* primary_hit, Sampler& sampler) const
 {
     BulbitNotUsed(primary_medium);
 
@@ -38,7 +38,7 @@ Spectrum PathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium
     while (true)
     {
         Intersection isect;
-        if (!Intersect(&isect, ray, Ray::epsilon, infinity))
+        if (!Intersect(&isect, ray, Ray::epsilon, infinity, primary_hit))
         {
             if (bounce == 0 || specular_bounce)
             {
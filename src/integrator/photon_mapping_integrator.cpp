@@ -304,6 +304,7 @@ void PhotonMappingIntegrator::GatherPhotons(const Camera* camera, int32 tile_siz
             BufferResource buffer(mem, sizeof(mem));
             Allocator alloc(&buffer);
             Sampler* sampler = sampler_prototype->Clone(alloc);
+            FilmTile film_tile(&progress->film, tile);
 
             for (Point2i pixel : tile)
             {
@@ -317,12 +318,14 @@ void PhotonMappingIntegrator::GatherPhotons(const Camera* camera, int32 tile_siz
                     Spectrum L = Li(primary_ray.ray, camera->GetMedium(), *sampler);
                     if (!L.IsNullish())
                     {
-                        progress->film.AddSample(pixel, primary_ray.weight * L);
+                        film_tile.AddSample(pixel, primary_ray.weight * L);
                     }
                 }
             }
 
-            progress->phase_works_dones[1].fetch_add(1, std::memory_order_relaxed);
+            progress->film.MergeTile(&film_tile);
+
+            progress->phase_works_dones[1].fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
         },
         tile_size
     );
@@ -333,10 +336,9 @@ Rendering* PhotonMappingIntegrator::Render(Allocator& alloc, const Camera* camer
     const int32 tile_size = 16;
 
     Point2i res = camera->GetScreenResolution();
-    Point2i num_tiles = (res + (tile_size - 1)) / tile_size;
-    int32 tile_count = num_tiles.x * num_tiles.y;
+    int32 pixel_count = res.x * res.y;
 
-    std::array<size_t, 2> phase_works = { size_t(n_photons), size_t(tile_count) };
+    std::array<size_t, 2> phase_works = { size_t(n_photons), size_t(pixel_count) };
     MultiPhaseRendering* progress = alloc.new_object<MultiPhaseRendering>(camera, phase_works);
 
     progress->job = RunAsync([=, this]() {
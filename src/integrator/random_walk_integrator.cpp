@@ -14,7 +14,9 @@ RandomWalkIntegrator::RandomWalkIntegrator(
 {
 }
 
-Spectrum RandomWalkIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
+Spectrum RandomWalkIntegrator::Li(
+    const Ray& primary_ray, const Medium* primary_medium, PrimaryHit* primary_hit, Sampler& sampler
+) const
 {
     BulbitNotUsed(primary_medium);
 
@@ -25,7 +27,7 @@ Spectrum RandomWalkIntegrator::Li(const Ray& primary_ray, const Medium* primary_
     while (true)
     {
         Intersection isect;
-        if (!Intersect(&isect, ray, Ray::epsilon, infinity))
+        if (!Intersect(&isect, ray, Ray::epsilon, infinity, primary_hit))
         {
             for (Light* light : infinite_lights)
             {
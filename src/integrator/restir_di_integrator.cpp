@@ -202,10 +202,8 @@ Rendering* ReSTIRDIIntegrator::Render(Allocator& alloc, const Camera* camera)
     const int32 tile_size = 16;
 
     const int32 num_pixels = resolution.x * resolution.y;
-    const Point2i num_tiles = (resolution + (tile_size - 1)) / tile_size;
-    const int32 tile_count = num_tiles.x * num_tiles.y;
     const int32 num_passes = 4;
-    const size_t total_works = size_t(std::max(spp, 1) * tile_count * num_passes);
+    const size_t total_works = size_t(std::max(spp, 1)) * num_pixels * num_passes;
 
     SinglePhaseRendering* progress = alloc.new_object<SinglePhaseRendering>(camera, total_works);
     progress->job = RunAsync([=, this]() {
@@ -460,7 +458,7 @@ Rendering* ReSTIRDIIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                    progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
@@ -509,7 +507,7 @@ Rendering* ReSTIRDIIntegrator::Render(Allocator& alloc, const Camera* camera)
                             }
                         }
 
-                        progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                        progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                     },
                     tile_size
                 );
@@ -675,7 +673,7 @@ Rendering* ReSTIRDIIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                    progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
@@ -710,7 +708,7 @@ Rendering* ReSTIRDIIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                    progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
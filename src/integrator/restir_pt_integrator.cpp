@@ -206,10 +206,8 @@ Rendering* ReSTIRPTIntegrator::Render(Allocator& alloc, const Camera* camera)
     const int32 tile_size = 16;
 
     const int32 num_pixels = resolution.x * resolution.y;
-    const Point2i num_tiles = (resolution + (tile_size - 1)) / tile_size;
-    const int32 tile_count = num_tiles.x * num_tiles.y;
     const int32 num_passes = 3;
-    const size_t total_works = size_t(std::max(spp, 1) * tile_count * num_passes);
+    const size_t total_works = size_t(std::max(spp, 1)) * num_pixels * num_passes;
 
     constexpr int32 earliest_reconnection_vertex = 2;
 
@@ -661,7 +659,7 @@ Rendering* ReSTIRPTIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                    progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
@@ -1083,7 +1081,7 @@ Rendering* ReSTIRPTIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                    progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
@@ -1116,7 +1114,7 @@ Rendering* ReSTIRPTIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->work_dones.fetch_add(1, std::memory_order_relaxed);
+                    progress->work_dones.fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
@@ -362,7 +362,7 @@ Spectrum ConnectVertices(
 
 void ConnectToCamera(
     const Integrator* I,
-    Film& film,
+    FilmTile& film_tile,
     const Camera* camera,
     const VCMSubPathState& light_state,
     const Intersection& isect,
@@ -422,7 +422,7 @@ void ConnectToCamera(
     Spectrum contribution = mis_weight * light_state.beta * f_cos * camera_sample.Wi / (light_subpath_count * camera_sample.pdf);
     if (!contribution.IsBlack())
     {
-        film.AddSplat(camera_sample.p_raster, contribution);
+        film_tile.AddSplat(camera_sample.p_raster, contribution);
     }
 }
 
@@ -463,14 +463,11 @@ Rendering* VCMIntegrator::Render(Allocator& alloc, const Camera* camera)
     const int32 path_count = res.x * res.y;
     const int32 light_subpath_count = path_count;
 
-    Point2i num_tiles = (res + (tile_size - 1)) / tile_size;
-    const int32 tile_count = num_tiles.x * num_tiles.y;
-
     std::vector<size_t> phase_works(2 * size_t(n_iterations));
     for (int32 i = 0; i < n_iterations; ++i)
     {
         phase_works[2 * i] = size_t(path_count);
-        phase_works[2 * i + 1] = size_t(tile_count);
+        phase_works[2 * i + 1] = size_t(path_count);
     }
 
     MultiPhaseRendering* progress = alloc.new_object<MultiPhaseRendering>(camera, phase_works);
@@ -517,6 +514,9 @@ Rendering* VCMIntegrator::Render(Allocator& alloc, const Camera* camera)
                 Allocator sampler_alloc(&buffer);
                 Sampler* sampler = sampler_prototype->Clone(sampler_alloc);
 
+                // Light paths splat to any pixel, the splats are buffered and merged per chunk
+                FilmTile film_tile(&progress->film);
+
                 Allocator& alloc = light_vertex_allocators.Get();
                 std::vector<LightPathChunk>& chunks = tl_light_chunks.Get();
                 chunks.emplace_back();
@@ -641,7 +641,7 @@ Rendering* VCMIntegrator::Render(Allocator& alloc, const Camera* camera)
                             if (light_state.path_length + 1 <= max_path_length)
                             {
                                 ConnectToCamera(
-                                    this, progress->film, camera, light_state, isect, wo, bsdf, vertex_cont_prob, mis_vm_weight,
+                                    this, film_tile, camera, light_state, isect, wo, bsdf, vertex_cont_prob, mis_vm_weight,
                                     light_subpath_count, *sampler
                                 );
                             }
@@ -662,6 +662,8 @@ Rendering* VCMIntegrator::Render(Allocator& alloc, const Camera* camera)
                     }
                 }
 
+                progress->film.MergeTile(&film_tile);
+
                 progress->phase_works_dones[2 * iteration].fetch_add(end - begin, std::memory_order_relaxed);
             });
 
@@ -935,7 +937,7 @@ Rendering* VCMIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->phase_works_dones[2 * iteration + 1].fetch_add(1, std::memory_order_relaxed);
+                    progress->phase_works_dones[2 * iteration + 1].fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
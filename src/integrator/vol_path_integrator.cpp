@@ -24,7 +24,9 @@ VolPathIntegrator::VolPathIntegrator(
 {
 }
 
-Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_medium, Sampler& sampler) const
+Spectrum VolPathIntegrator::Li(
+    const Ray& primary_ray, const Medium* primary_medium, PrimaryHit* primary_hit, Sampler& sampler
+) const
 {
     int32 wavelength = std::min<int32>(int32(sampler.Next1D() * 3), 2);
     int32 bounce = 0;
@@ -46,7 +48,7 @@ Spectrum VolPathIntegrator::Li(const Ray& primary_ray, const Medium* primary_med
     {
         Vec3 wo = Normalize(-ray.d);
         Intersection isect;
-        bool found_intersection = Intersect(&isect, ray, Ray::epsilon, infinity);
+        bool found_intersection = Intersect(&isect, ray, Ray::epsilon, infinity, primary_hit);
 
         if (medium)
         {
@@ -204,13 +204,12 @@ Rendering* VolSPPMIntegrator::Render(Allocator& alloc, const Camera* camera)
     const int32 tile_size = 16;
 
     Point2i res = camera->GetScreenResolution();
-    Point2i num_tiles = (res + (tile_size - 1)) / tile_size;
-    int32 tile_count = num_tiles.x * num_tiles.y;
+    int32 pixel_count = res.x * res.y;
 
     std::vector<size_t> phase_works(2 * n_interations);
     for (size_t i = 0; i < phase_works.size(); i += 2)
     {
-        phase_works[i] = size_t(tile_count);
+        phase_works[i] = size_t(pixel_count);
         phase_works[i + 1] = size_t(photons_per_iteration);
     }
 
@@ -569,7 +568,7 @@ Rendering* VolSPPMIntegrator::Render(Allocator& alloc, const Camera* camera)
                         }
                     }
 
-                    progress->phase_works_dones[2 * iteration].fetch_add(1, std::memory_order_relaxed);
+                    progress->phase_works_dones[2 * iteration].fetch_add(tile.GetSurfaceArea(), std::memory_order_relaxed);
                 },
                 tile_size
             );
@@ -0,0 +1,445 @@
+#include "bulbit/async_job.h"
+#include "bulbit/bsdf.h"
+#include "bulbit/bxdfs.h"
+#include "bulbit/camera.h"
+#include "bulbit/integrators.h"
+#include "bulbit/lights.h"
+#include "bulbit/material.h"
+#include "bulbit/parallel_for.h"
+#include "bulbit/progresses.h"
+#include "bulbit/sampler.h"
+
+namespace bulbit
+{
+
+// Paths in flight at once, the frame is rendered in waves of whole pixels
+static constexpr int32 max_wave_size = 1 << 18;
+
+// Rays are handed to the accelerator in batches of this size
+static constexpr int32 trace_batch_size = 64;
+
+// Rays waiting to be traced, at most one per path
+struct WavefrontRayQueue
+{
+    WavefrontRayQueue(int32 capacity)
+        : paths(capacity)
+        , rays(capacity)
+        , size{ 0 }
+    {
+    }
+
+    void Push(int32 path, const Ray& ray)
+    {
+        int32 index = size.fetch_add(1, std::memory_order_relaxed);
+        paths[index] = path;
+        rays[index] = ray;
+    }
+
+    std::vector<int32> paths;
+    std::vector<Ray> rays;
+    std::atomic<int32> size;
+};
+
+// Shadow rays of the direct light samples, Ld is added to the path radiance if the ray is unoccluded
+struct WavefrontShadowQueue
+{
+    WavefrontShadowQueue(int32 capacity)
+        : paths(capacity)
+        , rays(capacity)
+        , t_max(capacity)
+        , Ld(capacity)
+        , size{ 0 }
+    {
+    }
+
+    void Push(int32 path, const Ray& ray, Float visibility, const Spectrum& L)
+    {
+        int32 index = size.fetch_add(1, std::memory_order_relaxed);
+        paths[index] = path;
+        rays[index] = ray;
+        t_max[index] = visibility;
+        Ld[index] = L;
+    }
+
+    std::vector<int32> paths;
+    std::vector<Ray> rays;
+    std::vector<Float> t_max;
+    std::vector<Spectrum> Ld;
+    std::atomic<int32> size;
+};
+
+// State of the paths of a wave in SoA layout, indexed by path
+struct WavefrontPathStates
+{
+    struct alignas(16) SamplerStorage
+    {
+        int8 mem[64];
+    };
+
+    WavefrontPathStates(int32 capacity)
+        : sampler_storages(capacity)
+        , samplers(capacity)
+        , L(capacity)
+        , beta(capacity)
+        , primary_weight(capacity)
+        , eta_scale(capacity)
+        , prev_bsdf_pdf(capacity)
+        , bounce(capacity)
+        , specular_bounce(capacity)
+        , any_non_specular_bounces(capacity)
+    {
+    }
+
+    // Each path keeps its own sampler so that it consumes the same sample sequence as PathIntegrator
+    std::vector<SamplerStorage> sampler_storages;
+    std::vector<Sampler*> samplers;
+
+    std::vector<Spectrum> L;
+    std::vector<Spectrum> beta;
+    std::vector<Float> primary_weight;
+    std::vector<Float> eta_scale;
+    std::vector<Float> prev_bsdf_pdf;
+    std::vector<int32> bounce;
+    std::vector<uint8> specular_bounce;
+    std::vector<uint8> any_non_specular_bounces;
+};
+
+template <typename F>
+static void ParallelForBatches(int32 count, F&& func)
+{
+    ParallelFor(0, count, [&](int32 begin, int32 end) {
+        for (int32 i = begin; i < end; i += trace_batch_size)
+        {
+            func(i, std::min(i + trace_batch_size, end));
+        }
+    });
+}
+
+WavefrontPathIntegrator::WavefrontPathIntegrator(
+    const Intersectable* accel,
+    std::vector<Light*> lights,
+    const Sampler* sampler,
+    int32 max_bounces,
+    int32 rr_min_bounces,
+    bool regularize_bsdf
+)
+    : Integrator(accel, std::move(lights), std::make_unique<PowerLightSampler>())
+    , sampler_prototype{ sampler }
+    , max_bounces{ max_bounces }
+    , rr_min_bounces{ rr_min_bounces }
+    , regularize_bsdf{ regularize_bsdf }
+{
+}
+
+Rendering* WavefrontPathIntegrator::Render(Allocator& alloc, const Camera* camera)
+{
+    Point2i resolution = camera->GetScreenResolution();
+
+    const int32 spp = sampler_prototype->samples_per_pixel;
+
+    const int32 pixel_count = resolution.x * resolution.y;
+    const int32 wave_pixel_count = std::max(1, max_wave_size / spp);
+    const int32 wave_capacity = wave_pixel_count * spp;
+
+    SinglePhaseRendering* progress = alloc.new_object<SinglePhaseRendering>(camera, size_t(pixel_count));
+    progress->job = RunAsync([=, this]() {
+        WavefrontPathStates paths(wave_capacity);
+
+        WavefrontRayQueue ray_queue(wave_capacity);
+        WavefrontRayQueue next_ray_queue(wave_capacity);
+        WavefrontShadowQueue shadow_queue(wave_capacity);
+
+        // Results of the ray queue, indexed like the queue
+        std::vector<Intersection> isects(wave_capacity);
+        std::unique_ptr<bool[]> hits = std::make_unique<bool[]>(wave_capacity);
+
+        // Ray queue indices grouped by the material type of the hit, the last group has no material
+        constexpr int32 material_count = int32(Materials::count);
+        std::vector<int32> shade_keys(wave_capacity);
+        std::vector<int32> shade_order(wave_capacity);
+
+        for (int32 pixel_begin = 0; pixel_begin < pixel_count; pixel_begin += wave_pixel_count)
+        {
+            const int32 pixel_end = std::min(pixel_begin + wave_pixel_count, pixel_count);
+            const int32 path_count = (pixel_end - pixel_begin) * spp;
+
+            // Generate camera rays, the paths of a pixel are consecutive
+            ParallelFor(0, path_count, [&](int32 p) {
+                int32 pixel_index = pixel_begin + p / spp;
+                Point2i pixel(pixel_index % resolution.x, pixel_index / resolution.x);
+
+                BufferResource buffer(paths.sampler_storages[p].mem, sizeof(WavefrontPathStates::SamplerStorage));
+                Allocator sampler_alloc(&buffer);
+                Sampler* sampler = sampler_prototype->Clone(sampler_alloc);
+                sampler->StartPixelSample(pixel, p % spp);
+
+                Float u[4];
+                sampler->NextND(u);
+
+                PrimaryRay primary_ray;
+                camera->SampleRay(&primary_ray, pixel, { u[0], u[1] }, { u[2], u[3] });
+
+                paths.samplers[p] = sampler;
+                paths.L[p] = Spectrum(0);
+                paths.beta[p] = Spectrum(1);
+                paths.primary_weight[p] = primary_ray.weight;
+                paths.eta_scale[p] = 1;
+                paths.prev_bsdf_pdf[p] = 0;
+                paths.bounce[p] = 0;
+                paths.specular_bounce[p] = false;
+                paths.any_non_specular_bounces[p] = false;
+
+                ray_queue.paths[p] = p;
+                ray_queue.rays[p] = primary_ray.ray;
+            });
+
+            ray_queue.size.store(path_count);
+
+            while (int32 ray_count = ray_queue.size.load())
+            {
+                // Intersect
+                ParallelForBatches(ray_count, [&](int32 begin, int32 end) {
+                    int32 count = end - begin;
+                    accel->IntersectN(
+                        std::span(&isects[begin], count), std::span(&hits[begin], count),
+                        std::span(&ray_queue.rays[begin], count), Ray::epsilon, infinity
+                    );
+                });
+
+                // Add emitted light and find the paths that continue
+                ParallelFor(0, ray_count, [&](int32 i) {
+                    int32 p = ray_queue.paths[i];
+                    const Ray& ray = ray_queue.rays[i];
+
+                    Spectrum& L = paths.L[p];
+                    const Spectrum& beta = paths.beta[p];
+                    bool specular_bounce = paths.specular_bounce[p];
+
+                    shade_keys[i] = -1;
+
+                    if (!hits[i])
+                    {
+                        if (paths.bounce[p] == 0 || specular_bounce)
+                        {
+                            for (Light* light : infinite_lights)
+                            {
+                                L += beta * light->Le(ray);
+                            }
+                        }
+                        else
+                        {
+                            // Evaluate BSDF sample MIS for infinite light
+                            for (Light* light : infinite_lights)
+                            {
+                                Float light_pdf = light->EvaluatePDF_Li(ray) * light_sampler->EvaluatePMF(light);
+                                Float mis_weight = PowerHeuristic(1, paths.prev_bsdf_pdf[p], 1, light_pdf);
+
+                                L += beta * mis_weight * light->Le(ray);
+                            }
+                        }
+
+                        return;
+                    }
+
+                    const Intersection& isect = isects[i];
+                    Vec3 wo = Normalize(-ray.d);
+
+                    if (const Light* area_light = GetAreaLight(isect); area_light)
+                    {
+                        if (Spectrum Le = area_light->Le(isect, wo); !Le.IsBlack())
+                        {
+                            if (paths.bounce[p] == 0 || specular_bounce)
+                            {
+                                L += beta * Le;
+                            }
+                            else
+                            {
+                                // Evaluate BSDF sample with MIS for area light
+                                Float light_pdf =
+                                    isect.primitive->GetShape()->PDF(isect, ray) * light_sampler->EvaluatePMF(area_light);
+                                Float mis_weight = PowerHeuristic(1, paths.prev_bsdf_pdf[p], 1, light_pdf);
+
+                                L += beta * mis_weight * Le;
+                            }
+                        }
+                    }
+
+                    if (paths.bounce[p]++ >= max_bounces)
+                    {
+                        return;
+                    }
+
+                    const Material* material = isect.primitive->GetMaterial();
+                    shade_keys[i] = material ? material->type_index : material_count;
+                });
+
+                // Group the hits by material so that the shading stage runs one material at a time
+                std::array<int32, material_count + 3> offsets{};
+                for (int32 i = 0; i < ray_count; ++i)
+                {
+                    ++offsets[shade_keys[i] + 2];
+                }
+
+                for (int32 k = 1; k < material_count + 3; ++k)
+                {
+                    offsets[k] += offsets[k - 1];
+                }
+
+                // Terminated paths have the key -1 and come first
+                const int32 terminated_count = offsets[1];
+                const int32 shade_count = ray_count - terminated_count;
+                for (int32 i = 0; i < ray_count; ++i)
+                {
+                    if (shade_keys[i] >= 0)
+                    {
+                        shade_order[offsets[shade_keys[i] + 1]++ - terminated_count] = i;
+                    }
+                }
+
+                // Shade, queues a shadow ray for the direct light and the next ray of the path
+                ParallelFor(0, shade_count, [&](int32 j) {
+                    int32 i = shade_order[j];
+                    int32 p = ray_queue.paths[i];
+
+                    Intersection& isect = isects[i];
+                    Vec3 wo = Normalize(-ray_queue.rays[i].d);
+
+                    Sampler& sampler = *paths.samplers[p];
+                    Spectrum& beta = paths.beta[p];
+
+                    int8 mem[max_bxdf_size];
+                    BufferResource res(mem, sizeof(mem));
+                    Allocator bsdf_alloc(&res);
+                    BSDF bsdf;
+                    if (!isect.GetBSDF(&bsdf, wo, bsdf_alloc))
+                    {
+                        --paths.bounce[p];
+                        next_ray_queue.Push(p, Ray(isect.point, -wo));
+                        return;
+                    }
+
+                    // Blur bsdf if possible
+                    if (regularize_bsdf && paths.any_non_specular_bounces[p])
+                    {
+                        bsdf.Regularize();
+                    }
+
+                    // Sample direct light, the shadow ray is traced in the next stage
+                    if (IsNonSpecular(bsdf.Flags()))
+                    {
+                        Float u0 = sampler.Next1D();
+                        Point2 u12 = sampler.Next2D();
+
+                        SampledLight sampled_light;
+                        LightSampleLi light_sample;
+                        if (light_sampler->Sample(&sampled_light, isect, u0) &&
+                            sampled_light.light->Sample_Li(&light_sample, isect, u12))
+                        {
+                            Float bsdf_pdf = bsdf.PDF(wo, light_sample.wi);
+                            if (!light_sample.Li.IsBlack() && bsdf_pdf != 0)
+                            {
+                                Float light_pdf = sampled_light.pmf * light_sample.pdf;
+                                Spectrum f_cos = bsdf.f(wo, light_sample.wi) * AbsDot(isect.shading.normal, light_sample.wi);
+
+                                Spectrum Ld;
+                                if (sampled_light.light->IsDeltaLight())
+                                {
+                                    Ld = beta * light_sample.Li * f_cos / light_pdf;
+                                }
+                                else
+                                {
+                                    Float mis_weight = PowerHeuristic(1, light_pdf, 1, bsdf_pdf);
+                                    Ld = beta * mis_weight * light_sample.Li * f_cos / light_pdf;
+                                }
+
+                                shadow_queue.Push(p, Ray(isect.point, light_sample.wi), light_sample.visibility, Ld);
+                            }
+                        }
+                    }
+
+                    BSDFSample bsdf_sample;
+                    if (!bsdf.Sample_f(&bsdf_sample, wo, sampler.Next1D(), sampler.Next2D()))
+                    {
+                        return;
+                    }
+
+                    paths.specular_bounce[p] = bsdf_sample.IsSpecular();
+                    paths.any_non_specular_bounces[p] |= !bsdf_sample.IsSpecular();
+                    if (bsdf_sample.IsTransmission())
+                    {
+                        paths.eta_scale[p] *= Sqr(bsdf_sample.eta);
+                    }
+
+                    // Save bsdf pdf for MIS
+                    paths.prev_bsdf_pdf[p] = bsdf_sample.is_stochastic ? bsdf.PDF(wo, bsdf_sample.wi) : bsdf_sample.pdf;
+                    beta *= bsdf_sample.f * AbsDot(isect.shading.normal, bsdf_sample.wi) / bsdf_sample.pdf;
+
+                    // Terminate path with russian roulette
+                    if (paths.bounce[p] > rr_min_bounces)
+                    {
+                        if (Float q = beta.MaxComponent() * paths.eta_scale[p]; q < 1)
+                        {
+                            if (sampler.Next1D() > q)
+                            {
+                                return;
+                            }
+                            else
+                            {
+                                beta /= q;
+                            }
+                        }
+                    }
+
+                    next_ray_queue.Push(p, Ray(isect.point, bsdf_sample.wi));
+                });
+
+                // Trace shadow rays
+                int32 shadow_count = shadow_queue.size.load();
+                ParallelForBatches(shadow_count, [&](int32 begin, int32 end) {
+                    int32 count = end - begin;
+                    accel->IntersectAnyN(
+                        std::span(&hits[begin], count), std::span(&shadow_queue.rays[begin], count), Ray::epsilon,
+                        std::span(&shadow_queue.t_max[begin], count)
+                    );
+
+                    for (int32 i = begin; i < end; ++i)
+                    {
+                        if (!hits[i])
+                        {
+                            paths.L[shadow_queue.paths[i]] += shadow_queue.Ld[i];
+                        }
+                    }
+                });
+
+                shadow_queue.size.store(0);
+
+                std::swap(ray_queue.paths, next_ray_queue.paths);
+                std::swap(ray_queue.rays, next_ray_queue.rays);
+                ray_queue.size.store(next_ray_queue.size.load());
+                next_ray_queue.size.store(0);
+            }
+
+            // Accumulate, the samples of a pixel are added in order
+            ParallelFor(pixel_begin, pixel_end, [&](int32 pixel_index) {
+                Point2i pixel(pixel_index % resolution.x, pixel_index / resolution.x);
+
+                for (int32 p = (pixel_index - pixel_begin) * spp; p < (pixel_index - pixel_begin + 1) * spp; ++p)
+                {
+                    if (!paths.L[p].IsNullish())
+                    {
+                        progress->film.AddSample(pixel, paths.primary_weight[p] * paths.L[p]);
+                    }
+                }
+            });
+
+            progress->work_dones.fetch_add(pixel_end - pixel_begin, std::memory_order_relaxed);
+        }
+
+        progress->done.store(true, std::memory_order_release);
+        return true;
+    });
+
+    return progress;
+}
+
+} // namespace bulbit
@@ -13,7 +13,7 @@ WhittedStyle::WhittedStyle(const Intersectable* accel, std::vector<Light*> light
 {
 }
 
-Spectrum WhittedStyle::Li(const Ray& ray, Sampler& sampler, int32 depth) const
+Spectrum WhittedStyle::Li(const Ray& ray, Sampler& sampler, int32 depth, PrimaryHit* primary_hit) const
 {
     Spectrum L(0);
 
@@ -23,7 +23,7 @@ Spectrum WhittedStyle::Li(const Ray& ray, Sampler& sampler, int32 depth) const
     }
 
     Intersection isect;
-    if (!Intersect(&isect, ray, Ray::epsilon, infinity))
+    if (!Intersect(&isect, ray, Ray::epsilon, infinity, primary_hit))
     {
         for (auto& light : infinite_lights)
         {
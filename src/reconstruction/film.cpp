@@ -5,22 +5,71 @@
 namespace bulbit
 {
 
+FilmTile::FilmTile(Film* film)
+    : FilmTile(film, AABB2i(Point2i(0), Point2i(0)))
+{
+}
+
+FilmTile::FilmTile(Film* film, const AABB2i& bounds)
+    : film{ film }
+    , bounds{ bounds }
+{
+    Point2i extents = bounds.GetExtents();
+    size_t size = size_t(extents.x) * extents.y;
+
+    samples.resize(size, Spectrum(0));
+    sample_counts.resize(size, 0);
+    moments.resize(size, Point2(0));
+}
+
+void FilmTile::AddSample(const Point2i& pixel, const Spectrum& L)
+{
+    BulbitAssert(bounds.min.x <= pixel.x && pixel.x < bounds.max.x);
+    BulbitAssert(bounds.min.y <= pixel.y && pixel.y < bounds.max.y);
+
+    int32 index = (pixel.y - bounds.min.y) * (bounds.max.x - bounds.min.x) + (pixel.x - bounds.min.x);
+    samples[index] += L;
+    sample_counts[index] += 1;
+
+    Float l = L.Luminance();
+
+    Float alpha = 1.0f / sample_counts[index];
+    moments[index] = Lerp(moments[index], Point2(l, l * l), alpha);
+}
+
+void FilmTile::AddSplat(const Point2& pixel, const Spectrum& L)
+{
+    // The filter is resolved here so that contributions to the same pixel can be summed before they reach the film
+    film->ForEachSplatPixel(pixel, [&](int32 index, Float weight) { splats.push_back(Splat{ index, weight * L }); });
+
+    if (splats.size() >= max_pending_splats)
+    {
+        film->MergeSplats(&splats);
+    }
+}
+
 Film::Film(const Camera* camera)
     : camera{ camera }
 {
     Point2i res = camera->GetScreenResolution();
     int32 size = res.x * res.y;
-    samples = std::make_unique<Spectrum[]>(size);
-    sample_counts = std::make_unique<int32[]>(size);
-    moments = std::make_unique<Point2[]>(size);
-
-    splats = std::make_unique<std::atomic<Float>[]>(Spectrum::num_spectral_samples * size);
-
-    memset((void*)samples.get(), 0, sizeof(Spectrum) * size);
-    memset((void*)sample_counts.get(), 0, sizeof(int32) * size);
-    memset((void*)moments.get(), 0, sizeof(Point2) * size);
-
-    ParallelFor(0, Spectrum::num_spectral_samples * size, [&](int32 i) { splats[i].store(0); });
+    samples = std::make_unique_for_overwrite<Spectrum[]>(size);
+    sample_counts = std::make_unique_for_overwrite<int32[]>(size);
+    moments = std::make_unique_for_overwrite<Point2[]>(size);
+    splats = std::make_unique_for_overwrite<Float[]>(Spectrum::num_spectral_samples * size);
+
+    // Pages are placed on the NUMA node of the thread that touches them first, so the workers clear the rows
+    // instead of the calling thread. Tiles are claimed dynamically while rendering, so this spreads the film over
+    // the nodes rather than matching the node that later renders each tile
+    ParallelFor(0, res.y, [&](int32 begin, int32 end) {
+        int32 offset = begin * res.x;
+        int32 count = (end - begin) * res.x;
+
+        std::fill_n(samples.get() + offset, count, Spectrum(0));
+        std::fill_n(sample_counts.get() + offset, count, 0);
+        std::fill_n(moments.get() + offset, count, Point2(0));
+        std::fill_n(splats.get() + Spectrum::num_spectral_samples * offset, Spectrum::num_spectral_samples * count, Float(0));
+    });
 }
 
 void Film::AddSample(const Point2i& pixel, const Spectrum& L)
@@ -36,7 +85,8 @@ void Film::AddSample(const Point2i& pixel, const Spectrum& L)
     moments[index] = Lerp(moments[index], Point2(l, l * l), alpha);
 }
 
-void Film::AddSplat(const Point2& pixel, const Spectrum& L)
+template <typename F>
+void Film::ForEachSplatPixel(const Point2& pixel, F&& fcn) const
 {
     const Filter* filter = camera->GetFilter();
     Float half_extent = filter->extent / 2;
@@ -54,27 +104,85 @@ void Film::AddSplat(const Point2& pixel, const Spectrum& L)
         Float weight = filter->Evaluate(pixel - (Point2(pi) + Point2(0.5f)));
         if (weight > 0)
         {
-            int32 index = Spectrum::num_spectral_samples * (pi.y * res.x + pi.x);
-            for (int32 s = 0; s < Spectrum::num_spectral_samples; ++s)
-            {
-                Float old = splats[index + s].load();
-                splats[index + s].store(old + weight * L[s]);
-            }
+            fcn(pi.y * res.x + pi.x, weight);
         }
     }
 }
 
-void Film::WeightSplats(Float weight)
+void Film::AddSplat(const Point2& pixel, const Spectrum& L)
+{
+    ForEachSplatPixel(pixel, [&](int32 index, Float weight) {
+        for (int32 s = 0; s < Spectrum::num_spectral_samples; ++s)
+        {
+            std::atomic_ref<Float>(splats[Spectrum::num_spectral_samples * index + s])
+                .fetch_add(weight * L[s], std::memory_order_relaxed);
+        }
+    });
+}
+
+void Film::MergeTile(FilmTile* tile)
 {
     Point2i res = camera->GetScreenResolution();
-    int32 size = Spectrum::num_spectral_samples * res.x * res.y;
+    int32 tile_width = tile->bounds.max.x - tile->bounds.min.x;
 
-    ParallelFor(0, size, [&](int32 i) {
-        Float value = splats[i].load();
-        value *= weight;
+    for (Point2i pixel : tile->bounds)
+    {
+        int32 tile_index = (pixel.y - tile->bounds.min.y) * tile_width + (pixel.x - tile->bounds.min.x);
+        int32 tile_count = tile->sample_counts[tile_index];
+        if (tile_count == 0)
+        {
+            continue;
+        }
+
+        int32 index = pixel.y * res.x + pixel.x;
+        int32 count = sample_counts[index] + tile_count;
+
+        // Mean of the moments weighted by the sample counts
+        moments[index] = Lerp(moments[index], tile->moments[tile_index], Float(tile_count) / count);
+        samples[index] += tile->samples[tile_index];
+        sample_counts[index] = count;
+
+        tile->samples[tile_index] = Spectrum(0);
+        tile->sample_counts[tile_index] = 0;
+        tile->moments[tile_index] = Point2(0);
+    }
 
-        splats[i].store(value);
+    MergeSplats(&tile->splats);
+}
+
+void Film::MergeSplats(std::vector<FilmTile::Splat>* pending_splats)
+{
+    // Sorting groups the contributions to the same pixel, so each pixel takes one atomic add per flush
+    // and the film is walked in scanline order
+    std::sort(pending_splats->begin(), pending_splats->end(), [](const FilmTile::Splat& a, const FilmTile::Splat& b) {
+        return a.index < b.index;
     });
+
+    for (size_t i = 0; i < pending_splats->size();)
+    {
+        int32 index = (*pending_splats)[i].index;
+        Spectrum L = (*pending_splats)[i].L;
+        for (++i; i < pending_splats->size() && (*pending_splats)[i].index == index; ++i)
+        {
+            L += (*pending_splats)[i].L;
+        }
+
+        for (int32 s = 0; s < Spectrum::num_spectral_samples; ++s)
+        {
+            std::atomic_ref<Float>(splats[Spectrum::num_spectral_samples * index + s])
+                .fetch_add(L[s], std::memory_order_relaxed);
+        }
+    }
+
+    pending_splats->clear();
+}
+
+void Film::WeightSplats(Float weight)
+{
+    Point2i res = camera->GetScreenResolution();
+    int32 size = Spectrum::num_spectral_samples * res.x * res.y;
+
+    ParallelFor(0, size, [&](int32 i) { splats[i] *= weight; });
 }
 
 Image3 Film::GetRenderedImage() const
@@ -90,7 +198,7 @@ Image3 Film::GetRenderedImage() const
         Spectrum splat;
         for (int32 s = 0; s < Spectrum::num_spectral_samples; ++s)
         {
-            splat[s] = splats[index + s].load();
+            splat[s] = std::atomic_ref<Float>(splats[index + s]).load(std::memory_order_relaxed);
         }
 
         image[i] += splat;
@@ -117,4 +225,27 @@ Image1 Film::GetVarianceImage() const
     return image;
 }
 
+Image1 Film::GetRelativeErrorImage() const
+{
+    // Keeps the error of dark pixels from blowing up
+    constexpr Float min_luminance = 1e-2f;
+
+    Point2i res = camera->GetScreenResolution();
+    Image1 image(res.x, res.y);
+
+    ParallelFor(0, res.x * res.y, [&](int32 i) {
+        int32 n = sample_counts[i];
+        if (n < 2)
+        {
+            image[i] = infinity;
+            return;
+        }
+
+        Float variance = std::max(0.0f, moments[i][1] - Sqr(moments[i][0])) * n / (n - 1.0f);
+        image[i] = std::sqrt(variance / n) / (std::abs(moments[i][0]) + min_luminance);
+    });
+
+    return image;
+}
+
 } // namespace bulbit
@@ -0,0 +1,81 @@
+#include "bulbit/hash.h"
+#include "bulbit/low_discrepancy.h"
+#include "bulbit/samplers.h"
+
+namespace bulbit
+{
+
+BlueNoiseSampler::BlueNoiseSampler(int32 samples_per_pixel, int32 seed)
+    : Sampler(TypeIndexOf<BlueNoiseSampler>(), samples_per_pixel)
+    , seed{ seed }
+{
+    // Fibonacci like lattice, the generator closest to n / golden ratio that keeps the second coordinates distinct
+    const Float golden_ratio = (1 + std::sqrt(Float(5))) / 2;
+    generator = std::max(1, int32(std::round(samples_per_pixel / golden_ratio)));
+    while (std::gcd(generator, samples_per_pixel) != 1)
+    {
+        ++generator;
+    }
+
+    // Build the shared texture up front instead of inside the first rendered tile
+    GetBlueNoise(0, { 0, 0 });
+}
+
+void BlueNoiseSampler::StartPixelSample(const Point2i& pixel, int32 sample_index)
+{
+    Sampler::StartPixelSample(pixel, sample_index);
+    dimension = 0;
+}
+
+int32 BlueNoiseSampler::GetLatticeIndex() const
+{
+    // Same permutation in every pixel, so only the shift differs between pixels
+    uint64 hash = Hash(dimension, seed);
+    return PermutationElement(current_sample_index % samples_per_pixel, samples_per_pixel, uint32(hash));
+}
+
+Float BlueNoiseSampler::GetShift(int32 dimension_offset) const
+{
+    // Samples past samples_per_pixel repeat the lattice with another shift
+    int32 round = current_sample_index / samples_per_pixel;
+    return GetBlueNoise(int32(Hash(dimension + dimension_offset, round, seed)), current_pixel);
+}
+
+Float BlueNoiseSampler::Next1D()
+{
+    int32 index = GetLatticeIndex();
+    Float u = (index + GetShift(0)) / samples_per_pixel;
+
+    dimension += 1;
+
+    return std::fmin(u, 1 - epsilon);
+}
+
+Point2 BlueNoiseSampler::Next2D()
+{
+    int32 index = GetLatticeIndex();
+
+    // The lattice is invariant under shifts by (1, generator) / n, so [0, 1/n) x [0, 1) covers all shifts
+    Float u0 = (index + GetShift(0)) / samples_per_pixel;
+    Float u1 = Float((int64(index) * generator) % samples_per_pixel) / samples_per_pixel + GetShift(1);
+    if (u1 >= 1)
+    {
+        u1 -= 1;
+    }
+
+    dimension += 2;
+
+    return { std::fmin(u0, 1 - epsilon), std::fmin(u1, 1 - epsilon) };
+}
+
+void BlueNoiseSampler::NextND(std::span<Float> u)
+{
+    NextNDFrom2D(this, u);
+}
+
+Sampler* BlueNoiseSampler::Clone(Allocator& alloc) const
+{
+    return alloc.new_object<BlueNoiseSampler>(samples_per_pixel, seed);
+}
+
+} // namespace bulbit
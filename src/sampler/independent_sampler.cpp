@@ -5,7 +5,7 @@ namespace bulbit
 {
 
 IndependentSampler::IndependentSampler(int32 samples_per_pixel, int32 seed)
-    : Sampler(samples_per_pixel)
+    : Sampler(TypeIndexOf<IndependentSampler>(), samples_per_pixel)
     , seed{ seed }
 {
 }
@@ -26,6 +26,14 @@ Point2 IndependentSampler::Next2D()
     return Point2{ rng.NextFloat(), rng.NextFloat() };
 }
 
+void IndependentSampler::NextND(std::span<Float> u)
+{
+    for (Float& v : u)
+    {
+        v = rng.NextFloat();
+    }
+}
+
 Sampler* IndependentSampler::Clone(Allocator& alloc) const
 {
     return alloc.new_object<IndependentSampler>(samples_per_pixel, seed);
@@ -0,0 +1,191 @@
+#include "bulbit/low_discrepancy.h"
+#include "bulbit/random.h"
+
+namespace bulbit
+{
+
+// Full Owen scramble, each digit is flipped by a random bit of the tree node its higher digits lead to
+static uint32 OwenScramble(uint32 v, uint64 seed)
+{
+    uint32 result = 0;
+    for (int32 d = 0; d < 32; ++d)
+    {
+        uint64 node = d == 0 ? 0 : uint64(v >> (32 - d));
+        uint32 flip = uint32(MixBits(seed ^ (node << 6) ^ uint64(d)) >> 63);
+        uint32 bit = ((v >> (31 - d)) & 1) ^ flip;
+
+        result |= bit << (31 - d);
+    }
+
+    return result;
+}
+
+static std::vector<Point2> GeneratePMJ02Samples()
+{
+    std::vector<Point2> samples(pmj02_set_count * pmj02_set_size);
+
+    for (int32 set = 0; set < pmj02_set_count; ++set)
+    {
+        uint64 seed_x = MixBits(2 * set + 1);
+        uint64 seed_y = MixBits(2 * set + 2);
+
+        for (int32 i = 0; i < pmj02_set_size; ++i)
+        {
+            uint32 x = OwenScramble(SobolBits(i, 0), seed_x);
+            uint32 y = OwenScramble(SobolBits(i, 1), seed_y);
+
+            samples[set * pmj02_set_size + i] = { std::fmin(1 - epsilon, Float(x * 0x1p-32f)),
+                                                  std::fmin(1 - epsilon, Float(y * 0x1p-32f)) };
+        }
+    }
+
+    return samples;
+}
+
+// Ulichney 1993, The void-and-cluster method for dither array generation
+static std::vector<Float> GenerateBlueNoise()
+{
+    constexpr int32 n = blue_noise_resolution;
+    constexpr int32 size = n * n;
+    constexpr int32 radius = 6;
+    constexpr int32 width = 2 * radius + 1;
+    constexpr Float sigma = 1.5f;
+
+    Float kernel[width * width];
+    for (int32 y = -radius; y <= radius; ++y)
+    {
+        for (int32 x = -radius; x <= radius; ++x)
+        {
+            kernel[(y + radius) * width + (x + radius)] = std::exp(-(x * x + y * y) / (2 * sigma * sigma));
+        }
+    }
+
+    // Gaussian weighted density of the set pixels around each pixel, wrapping around the edges
+    std::vector<uint8> pattern(size, 0);
+    std::vector<Float> energy(size, 0);
+
+    auto splat = [&](int32 index, Float sign) {
+        int32 px = index % n;
+        int32 py = index / n;
+        for (int32 y = -radius; y <= radius; ++y)
+        {
+            for (int32 x = -radius; x <= radius; ++x)
+            {
+                int32 i = ((py + y + n) % n) * n + (px + x + n) % n;
+                energy[i] += sign * kernel[(y + radius) * width + (x + radius)];
+            }
+        }
+    };
+
+    auto tightest_cluster = [&]() {
+        int32 result = -1;
+        for (int32 i = 0; i < size; ++i)
+        {
+            if (pattern[i] && (result < 0 || energy[i] > energy[result]))
+            {
+                result = i;
+            }
+        }
+        return result;
+    };
+
+    auto largest_void = [&]() {
+        int32 result = -1;
+        for (int32 i = 0; i < size; ++i)
+        {
+            if (!pattern[i] && (result < 0 || energy[i] < energy[result]))
+            {
+                result = i;
+            }
+        }
+        return result;
+    };
+
+    // Random initial pattern with a tenth of the pixels set
+    const int32 initial_count = size / 10;
+
+    RNG rng(Hash(n));
+    for (int32 count = 0; count < initial_count;)
+    {
+        int32 i = rng.NextUint() % size;
+        if (!pattern[i])
+        {
+            pattern[i] = 1;
+            splat(i, 1);
+            ++count;
+        }
+    }
+
+    // Move pixels from the tightest cluster to the largest void until the pattern is stable
+    for (int32 iteration = 0; iteration < size; ++iteration)
+    {
+        int32 cluster = tightest_cluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1);
+
+        int32 void_ = largest_void();
+        pattern[void_] = 1;
+        splat(void_, 1);
+
+        if (void_ == cluster)
+        {
+            break;
+        }
+    }
+
+    std::vector<uint8> initial_pattern = pattern;
+    std::vector<Float> initial_energy = energy;
+    std::vector<int32> ranks(size);
+
+    // Rank the initial pixels by removing the tightest clusters first
+    for (int32 rank = initial_count - 1; rank >= 0; --rank)
+    {
+        int32 cluster = tightest_cluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1);
+        ranks[cluster] = rank;
+    }
+
+    // Rank the remaining pixels by filling the largest voids, past the half this equals removing the tightest clusters
+    // of the unset pixels since both energies sum to a constant
+    pattern = std::move(initial_pattern);
+    energy = std::move(initial_energy);
+    for (int32 rank = initial_count; rank < size; ++rank)
+    {
+        int32 void_ = largest_void();
+        pattern[void_] = 1;
+        splat(void_, 1);
+        ranks[void_] = rank;
+    }
+
+    std::vector<Float> texture(size);
+    for (int32 i = 0; i < size; ++i)
+    {
+        texture[i] = (ranks[i] + Float(0.5)) / size;
+    }
+
+    return texture;
+}
+
+Point2 GetPMJ02Sample(int32 set, int32 index)
+{
+    BulbitAssert(0 <= set && set < pmj02_set_count);
+    BulbitAssert(0 <= index && index < pmj02_set_size);
+
+    static const std::vector<Point2> samples = GeneratePMJ02Samples();
+    return samples[set * pmj02_set_size + index];
+}
+
+Float GetBlueNoise(int32 texture, Point2i pixel)
+{
+    constexpr int32 n = blue_noise_resolution;
+    static const std::vector<Float> values = GenerateBlueNoise();
+
+    uint64 offset = Hash(texture);
+    int32 x = int32((uint32(pixel.x) + uint32(offset)) % n);
+    int32 y = int32((uint32(pixel.y) + uint32(offset >> 32)) % n);
+
+    return values[y * n + x];
+}
+
+} // namespace bulbit
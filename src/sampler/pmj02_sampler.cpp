@@ -0,0 +1,63 @@
+#include "bulbit/hash.h"
+#include "bulbit/low_discrepancy.h"
+#include "bulbit/samplers.h"
+
+namespace bulbit
+{
+
+PMJ02Sampler::PMJ02Sampler(int32 samples_per_pixel, int32 seed)
+    : Sampler(TypeIndexOf<PMJ02Sampler>(), samples_per_pixel)
+    , seed{ seed }
+{
+    // Build the shared point sets up front instead of inside the first rendered tile
+    GetPMJ02Sample(0, 0);
+}
+
+void PMJ02Sampler::StartPixelSample(const Point2i& pixel, int32 sample_index)
+{
+    Sampler::StartPixelSample(pixel, sample_index);
+    dimension = 0;
+    pixel_hash = Hash(pixel, seed);
+}
+
+Point2 PMJ02Sampler::GetSample()
+{
+    uint64 hash = MixBits(pixel_hash ^ uint64(dimension));
+    int32 index = PermutationElement(current_sample_index % samples_per_pixel, samples_per_pixel, uint32(hash));
+
+    // Every full set of samples continues in the next point set, and samples past samples_per_pixel continue in the
+    // point sets after the ones of the previous round
+    int32 round = current_sample_index / samples_per_pixel;
+    int32 round_set_count = (samples_per_pixel + pmj02_set_size - 1) / pmj02_set_size;
+
+    uint64 set = (hash >> 32) + uint64(round) * round_set_count + index / pmj02_set_size;
+    return GetPMJ02Sample(int32(set % pmj02_set_count), index % pmj02_set_size);
+}
+
+Float PMJ02Sampler::Next1D()
+{
+    Float u = GetSample().x;
+    dimension += 1;
+
+    return u;
+}
+
+Point2 PMJ02Sampler::Next2D()
+{
+    Point2 u = GetSample();
+    dimension += 2;
+
+    return u;
+}
+
+void PMJ02Sampler::NextND(std::span<Float> u)
+{
+    NextNDFrom2D(this, u);
+}
+
+Sampler* PMJ02Sampler::Clone(Allocator& alloc) const
+{
+    return alloc.new_object<PMJ02Sampler>(samples_per_pixel, seed);
+}
+
+} // namespace bulbit
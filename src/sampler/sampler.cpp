@@ -4,7 +4,7 @@
 namespace bulbit
 {
 
-Sampler* Sampler::Create(Allocator& alloc, const SamplerInfo& si)
+Sampler* Sampler::Create(Allocator& alloc, const SamplerInfo& si, Point2i resolution)
 {
     switch (si.type)
     {
@@ -15,6 +15,14 @@ Sampler* Sampler::Create(Allocator& alloc, const SamplerInfo& si)
         int32 h = int32(std::sqrt(si.spp));
         return alloc.new_object<StratifiedSampler>(h, h, true);
     }
+    case SamplerType::sobol:
+        return alloc.new_object<SobolSampler>(int32(std::bit_ceil(uint32(si.spp))));
+    case SamplerType::z_sobol:
+        return alloc.new_object<ZSobolSampler>(int32(std::bit_ceil(uint32(si.spp))), resolution);
+    case SamplerType::pmj02:
+        return alloc.new_object<PMJ02Sampler>(si.spp);
+    case SamplerType::blue_noise:
+        return alloc.new_object<BlueNoiseSampler>(si.spp);
 
     default:
         return nullptr;
@@ -0,0 +1,54 @@
+#include "bulbit/hash.h"
+#include "bulbit/low_discrepancy.h"
+#include "bulbit/samplers.h"
+
+namespace bulbit
+{
+
+SobolSampler::SobolSampler(int32 samples_per_pixel, int32 seed)
+    : Sampler(TypeIndexOf<SobolSampler>(), samples_per_pixel)
+    , seed{ seed }
+{
+}
+
+void SobolSampler::StartPixelSample(const Point2i& pixel, int32 sample_index)
+{
+    Sampler::StartPixelSample(pixel, sample_index);
+    dimension = 0;
+
+    // Samples past samples_per_pixel are taken from a differently permuted and scrambled copy of the sequence
+    pixel_hash = Hash(pixel, seed, sample_index / samples_per_pixel);
+}
+
+Float SobolSampler::Next1D()
+{
+    uint64 hash = MixBits(pixel_hash ^ uint64(dimension));
+    int32 index = PermutationElement(current_sample_index % samples_per_pixel, samples_per_pixel, uint32(hash));
+
+    dimension += 1;
+
+    return SobolSample(index, 0, FastOwenScrambler{ uint32(hash >> 32) });
+}
+
+Point2 SobolSampler::Next2D()
+{
+    uint64 hash = MixBits(pixel_hash ^ uint64(dimension));
+    int32 index = PermutationElement(current_sample_index % samples_per_pixel, samples_per_pixel, uint32(hash));
+
+    dimension += 2;
+
+    return { SobolSample(index, 0, FastOwenScrambler{ uint32(hash) }),
+             SobolSample(index, 1, FastOwenScrambler{ uint32(hash >> 32) }) };
+}
+
+void SobolSampler::NextND(std::span<Float> u)
+{
+    NextNDFrom2D(this, u);
+}
+
+Sampler* SobolSampler::Clone(Allocator& alloc) const
+{
+    return alloc.new_object<SobolSampler>(samples_per_pixel, seed);
+}
+
+} // namespace bulbit
@@ -5,7 +5,7 @@ namespace bulbit
 {
 
 StratifiedSampler::StratifiedSampler(int32 x_samples, int32 y_samples, bool jitter, int32 seed)
-    : Sampler(x_samples * y_samples)
+    : Sampler(TypeIndexOf<StratifiedSampler>(), x_samples * y_samples)
     , jitter{ jitter }
     , x_samples{ x_samples }
     , y_samples{ y_samples }
@@ -49,6 +49,11 @@ Point2 StratifiedSampler::Next2D()
     return { (x + dx) / x_samples, (y + dy) / y_samples };
 }
 
+void StratifiedSampler::NextND(std::span<Float> u)
+{
+    NextNDFrom2D(this, u);
+}
+
 Sampler* StratifiedSampler::Clone(Allocator& alloc) const
 {
     return alloc.new_object<StratifiedSampler>(x_samples, y_samples, jitter, seed);
@@ -0,0 +1,101 @@
+#include "bulbit/hash.h"
+#include "bulbit/low_discrepancy.h"
+#include "bulbit/samplers.h"
+
+namespace bulbit
+{
+
+ZSobolSampler::ZSobolSampler(int32 samples_per_pixel, Point2i resolution, int32 seed)
+    : Sampler(TypeIndexOf<ZSobolSampler>(), samples_per_pixel)
+    , seed{ seed }
+{
+    BulbitAssert(std::has_single_bit(uint32(samples_per_pixel)));
+
+    log2_samples_per_pixel = std::countr_zero(uint32(samples_per_pixel));
+
+    int32 log4_samples_per_pixel = (log2_samples_per_pixel + 1) / 2;
+    int32 log2_resolution = std::countr_zero(std::bit_ceil(uint32(std::max(resolution.x, resolution.y))));
+    base4_digit_count = log2_resolution + log4_samples_per_pixel;
+}
+
+void ZSobolSampler::StartPixelSample(const Point2i& pixel, int32 sample_index)
+{
+    Sampler::StartPixelSample(pixel, sample_index);
+    dimension = 0;
+
+    sample_round = sample_index >> log2_samples_per_pixel;
+    morton_index = (EncodeMorton2(pixel.x, pixel.y) << log2_samples_per_pixel) |
+                   uint64(sample_index & (samples_per_pixel - 1));
+}
+
+Float ZSobolSampler::Next1D()
+{
+    uint64 sample_index = GetSampleIndex();
+
+    dimension += 1;
+    uint64 hash = Hash(dimension, seed, sample_round);
+
+    return SobolSample(sample_index, 0, FastOwenScrambler{ uint32(hash) });
+}
+
+Point2 ZSobolSampler::Next2D()
+{
+    uint64 sample_index = GetSampleIndex();
+
+    dimension += 2;
+    uint64 hash = Hash(dimension, seed, sample_round);
+
+    return { SobolSample(sample_index, 0, FastOwenScrambler{ uint32(hash) }),
+             SobolSample(sample_index, 1, FastOwenScrambler{ uint32(hash >> 32) }) };
+}
+
+void ZSobolSampler::NextND(std::span<Float> u)
+{
+    NextNDFrom2D(this, u);
+}
+
+Sampler* ZSobolSampler::Clone(Allocator& alloc) const
+{
+    return alloc.new_object<ZSobolSampler>(*this);
+}
+
+uint64 ZSobolSampler::GetSampleIndex() const
+{
+    // clang-format off
+    static constexpr uint8 permutations[24][4] = {
+        { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 1, 3 }, { 0, 2, 3, 1 }, { 0, 3, 2, 1 }, { 0, 3, 1, 2 },
+        { 1, 0, 2, 3 }, { 1, 0, 3, 2 }, { 1, 2, 0, 3 }, { 1, 2, 3, 0 }, { 1, 3, 2, 0 }, { 1, 3, 0, 2 },
+        { 2, 1, 0, 3 }, { 2, 1, 3, 0 }, { 2, 0, 1, 3 }, { 2, 0, 3, 1 }, { 2, 3, 0, 1 }, { 2, 3, 1, 0 },
+        { 3, 1, 2, 0 }, { 3, 1, 0, 2 }, { 3, 2, 1, 0 }, { 3, 2, 0, 1 }, { 3, 0, 2, 1 }, { 3, 0, 1, 2 },
+    };
+    // clang-format on
+
+    // With an odd power of two samples per pixel the last digit is in base 2
+    bool pow2_samples = log2_samples_per_pixel & 1;
+    int32 last_digit = pow2_samples ? 1 : 0;
+
+    // Permute each base 4 digit depending on the digits above it, so that the pixels of a quad take the
+    // samples of a Sobol 4-tuple in a random order
+    uint64 sample_index = 0;
+    for (int32 i = base4_digit_count - 1; i >= last_digit; --i)
+    {
+        int32 digit_shift = 2 * i - (pow2_samples ? 1 : 0);
+        int32 digit = (morton_index >> digit_shift) & 3;
+
+        uint64 higher_digits = morton_index >> (digit_shift + 2);
+        int32 p = (MixBits(higher_digits ^ (0x55555555u * uint32(dimension))) >> 24) % 24;
+
+        digit = permutations[p][digit];
+        sample_index |= uint64(digit) << digit_shift;
+    }
+
+    if (pow2_samples)
+    {
+        int32 digit = morton_index & 1;
+        sample_index |= digit ^ (MixBits((morton_index >> 1) ^ (0x55555555u * uint32(dimension))) & 1);
+    }
+
+    return sample_index;
+}
+
+} // namespace bulbit
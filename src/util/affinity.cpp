@@ -0,0 +1,232 @@
+#include "bulbit/parallel.h"
+
+#include <cctype>
+#include <numeric>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+
+#include <fstream>
+#endif
+
+namespace bulbit
+{
+
+bool ParseIndexList(std::string_view list, std::vector<int32>* out_indices)
+{
+    out_indices->clear();
+
+    while (!list.empty())
+    {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+        // Trailing newline of the sysfs files
+        while (!item.empty() && std::isspace((unsigned char)item.back()))
+        {
+            item.remove_suffix(1);
+        }
+
+        if (item.empty())
+        {
+            continue;
+        }
+
+        auto parse = [](std::string_view s, int32* value) {
+            if (s.empty() || s.size() > 9 || !std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            {
+                return false;
+            }
+
+            *value = 0;
+            for (char c : s)
+            {
+                *value = *value * 10 + (c - '0');
+            }
+
+            return true;
+        };
+
+        int32 first, last;
+        size_t dash = item.find('-');
+        if (dash == std::string_view::npos)
+        {
+            if (!parse(item, &first))
+            {
+                return false;
+            }
+            last = first;
+        }
+        else if (!parse(item.substr(0, dash), &first) || !parse(item.substr(dash + 1), &last) || last < first)
+        {
+            return false;
+        }
+
+        for (int32 i = first; i <= last; ++i)
+        {
+            out_indices->push_back(i);
+        }
+    }
+
+    return !out_indices->empty();
+}
+
+#if defined(_WIN32)
+
+// Processors are numbered group * 64 + index within the group
+
+std::vector<std::vector<int32>> GetNumaNodes()
+{
+    std::vector<std::vector<int32>> nodes;
+
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationNumaNode, nullptr, &length);
+    if (GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+    {
+        std::vector<uint8> buffer(length);
+        auto info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)buffer.data();
+
+        if (GetLogicalProcessorInformationEx(RelationNumaNode, info, &length))
+        {
+            for (DWORD offset = 0; offset < length;)
+            {
+                auto entry = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)(buffer.data() + offset);
+                offset += entry->Size;
+
+                const GROUP_AFFINITY& affinity = entry->NumaNode.GroupMask;
+
+                std::vector<int32> processors;
+                for (int32 i = 0; i < 64; ++i)
+                {
+                    if (affinity.Mask & (KAFFINITY(1) << i))
+                    {
+                        processors.push_back(int32(affinity.Group) * 64 + i);
+                    }
+                }
+
+                if (!processors.empty())
+                {
+                    nodes.push_back(std::move(processors));
+                }
+            }
+        }
+    }
+
+    if (nodes.empty())
+    {
+        std::vector<int32> processors(std::max(1u, std::thread::hardware_concurrency()));
+        std::iota(processors.begin(), processors.end(), 0);
+        nodes.push_back(std::move(processors));
+    }
+
+    return nodes;
+}
+
+bool SetThreadAffinity(int32 processor)
+{
+    GROUP_AFFINITY affinity{};
+    affinity.Group = WORD(processor / 64);
+    affinity.Mask = KAFFINITY(1) << (processor % 64);
+
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+}
+
+#elif defined(__linux__)
+
+std::vector<std::vector<int32>> GetNumaNodes()
+{
+    // Leave out the processors excluded by taskset or cgroups
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool has_allowed = sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0;
+
+    auto is_allowed = [&](int32 processor) {
+        return !has_allowed || (processor < CPU_SETSIZE && CPU_ISSET(processor, &allowed));
+    };
+
+    std::vector<std::vector<int32>> nodes;
+
+    const std::filesystem::path node_directory = "/sys/devices/system/node";
+    std::error_code error;
+    for (int32 node = 0; std::filesystem::exists(node_directory / ("node" + std::to_string(node)), error); ++node)
+    {
+        std::ifstream file(node_directory / ("node" + std::to_string(node)) / "cpulist");
+        std::string list;
+        std::getline(file, list);
+
+        std::vector<int32> processors;
+        if (!ParseIndexList(list, &processors))
+        {
+            // Memory only nodes have no processors
+            continue;
+        }
+
+        std::erase_if(processors, [&](int32 processor) { return !is_allowed(processor); });
+        if (!processors.empty())
+        {
+            nodes.push_back(std::move(processors));
+        }
+    }
+
+    if (nodes.empty())
+    {
+        std::vector<int32> processors;
+        for (int32 i = 0; i < CPU_SETSIZE && int32(processors.size()) < CPU_COUNT(&allowed); ++i)
+        {
+            if (is_allowed(i))
+            {
+                processors.push_back(i);
+            }
+        }
+
+        if (processors.empty())
+        {
+            processors.resize(std::max(1u, std::thread::hardware_concurrency()));
+            std::iota(processors.begin(), processors.end(), 0);
+        }
+
+        nodes.push_back(std::move(processors));
+    }
+
+    return nodes;
+}
+
+bool SetThreadAffinity(int32 processor)
+{
+    if (processor < 0 || processor >= CPU_SETSIZE)
+    {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(processor, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+}
+
+#else
+
+std::vector<std::vector<int32>> GetNumaNodes()
+{
+    std::vector<int32> processors(std::max(1u, std::thread::hardware_concurrency()));
+    std::iota(processors.begin(), processors.end(), 0);
+
+    return { processors };
+}
+
+bool SetThreadAffinity(int32 processor)
+{
+    BulbitNotUsed(processor);
+    return false;
+}
+
+#endif
+
+} // namespace bulbit
@@ -4,15 +4,214 @@
 namespace bulbit
 {
 
+// Deques for threads outside of the pool, e.g. the main thread
+constexpr int32 external_slot_count = 4;
+
+// Rounds of looking for work before a thread goes to sleep
+constexpr int32 park_spin_count = 64;
+
+// Chase-Lev deque, see "Correct and Efficient Work-Stealing for Weak Memory Models" by Lê et al.
+// Push and Pop are called by the owner only, Steal by any thread
+class WorkStealingDeque
+{
+public:
+    WorkStealingDeque()
+    {
+        buffers.push_back(std::make_unique<Buffer>(256));
+        buffer.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    void Push(ParallelJob* job)
+    {
+        int64 b = bottom.load(std::memory_order_relaxed);
+        int64 t = top.load(std::memory_order_acquire);
+        Buffer* a = buffer.load(std::memory_order_relaxed);
+
+        if (b - t > a->mask)
+        {
+            // Thieves may still read from the old buffer, it is kept until the deque is destroyed
+            auto grown = std::make_unique<Buffer>(2 * (a->mask + 1));
+            for (int64 i = t; i < b; ++i)
+            {
+                grown->Put(i, a->Get(i));
+            }
+
+            a = grown.get();
+            buffers.push_back(std::move(grown));
+            buffer.store(a, std::memory_order_release);
+        }
+
+        a->Put(b, job);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    ParallelJob* Pop()
+    {
+        int64 b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* a = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64 t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        ParallelJob* job = a->Get(b);
+        if (t == b)
+        {
+            // Last job, race against the thieves
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                job = nullptr;
+            }
+
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    ParallelJob* Steal()
+    {
+        int64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64 b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+        {
+            return nullptr;
+        }
+
+        Buffer* a = buffer.load(std::memory_order_acquire);
+        ParallelJob* job = a->Get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            // Lost the race against the owner or another thief
+            return nullptr;
+        }
+
+        return job;
+    }
+
+    bool IsEmpty() const
+    {
+        return bottom.load(std::memory_order_acquire) <= top.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Buffer
+    {
+        Buffer(int64 capacity)
+            : mask{ capacity - 1 }
+            , jobs{ std::make_unique<std::atomic<ParallelJob*>[]>(capacity) }
+        {
+        }
+
+        ParallelJob* Get(int64 i) const
+        {
+            return jobs[i & mask].load(std::memory_order_relaxed);
+        }
+
+        void Put(int64 i, ParallelJob* job)
+        {
+            jobs[i & mask].store(job, std::memory_order_relaxed);
+        }
+
+        int64 mask;
+        std::unique_ptr<std::atomic<ParallelJob*>[]> jobs;
+    };
+
+    alignas(64) std::atomic<int64> top = 0;
+    alignas(64) std::atomic<int64> bottom = 0;
+    std::atomic<Buffer*> buffer;
+
+    std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+struct ThreadPool::Slot
+{
+    WorkStealingDeque deque;
+
+    // Only this thread pushes and pops
+    std::atomic<std::thread::id> owner;
+
+    // NUMA node of the owner if the threads are pinned
+    int32 node = 0;
+};
+
+struct SlotCache
+{
+    const ThreadPool* thread_pool = nullptr;
+    int32 index = -1;
+};
+
+static thread_local SlotCache slot_cache;
+
+// Releases the external deques claimed by the thread when it exits, so that later threads can claim them
+struct ThreadPool::ExternalSlotGuard
+{
+    ~ExternalSlotGuard()
+    {
+        for (auto& [weak_slots, index] : claims)
+        {
+            if (std::shared_ptr<Slot[]> slots = weak_slots.lock())
+            {
+                slots[index].owner.store(std::thread::id(), std::memory_order_release);
+            }
+        }
+    }
+
+    std::vector<std::pair<std::weak_ptr<Slot[]>, int32>> claims;
+};
+
 ThreadPool::ThreadPool(int32 worker_count)
+    : ThreadPool(worker_count, {})
+{
+}
+
+ThreadPool::ThreadPool(int32 worker_count, std::span<const int32> _processors)
+    : processors(_processors.begin(), _processors.end())
 {
     worker_count = std::max(worker_count, 2);
 
+    // Deques must exist before any worker starts stealing
+    slot_count = worker_count - 1 + external_slot_count;
+    slots = std::shared_ptr<Slot[]>(new Slot[slot_count]);
+
+    if (!processors.empty())
+    {
+        std::vector<std::vector<int32>> nodes = GetNumaNodes();
+        auto get_node = [&](int32 processor) {
+            for (size_t node = 0; node < nodes.size(); ++node)
+            {
+                if (std::find(nodes[node].begin(), nodes[node].end(), processor) != nodes[node].end())
+                {
+                    return int32(node);
+                }
+            }
+            return 0;
+        };
+
+        // Worker i runs on processors[i + 1], external threads are assumed to share the node of the calling thread
+        for (int32 i = 0; i < slot_count; ++i)
+        {
+            int32 processor = i < worker_count - 1 ? processors[(i + 1) % processors.size()] : processors[0];
+            slots[i].node = get_node(processor);
+            numa_aware |= slots[i].node != slots[0].node;
+        }
+
+        SetThreadAffinity(processors[0]);
+    }
+
     // Calling thread also participates in executing parallel work,
     // so we launches one fewer than the requested number of threads.
     for (int32 i = 0; i < worker_count - 1; ++i)
     {
-        threads.emplace_back(&ThreadPool::Worker, this);
+        threads.emplace_back(&ThreadPool::Worker, this, i);
     }
 }
 
@@ -23,11 +222,8 @@ ThreadPool::~ThreadPool()
         return;
     }
 
-    {
-        std::lock_guard<std::mutex> lock(mutex);
-        shutdown = true;
-        job_list_condition.notify_all();
-    }
+    shutdown.store(true);
+    Notify();
 
     for (std::thread& thread : threads)
     {
@@ -35,123 +231,195 @@ ThreadPool::~ThreadPool()
     }
 }
 
-void ThreadPool::Worker()
+void ThreadPool::Worker(int32 index)
 {
-    std::unique_lock<std::mutex> lock(mutex);
+    if (!processors.empty())
+    {
+        SetThreadAffinity(processors[(index + 1) % processors.size()]);
+    }
 
-    while (!shutdown)
+    slots[index].owner.store(std::this_thread::get_id());
+    slot_cache = SlotCache{ this, index };
+
+    while (!shutdown.load(std::memory_order_acquire))
     {
-        WorkOrWait(&lock);
+        if (!RunPendingJob())
+        {
+            Park([this]() { return shutdown.load(std::memory_order_acquire); });
+        }
     }
 }
 
-void ThreadPool::WorkOrWait(std::unique_lock<std::mutex>* lock)
+int32 ThreadPool::FindSlotIndex()
 {
-    BulbitAssert(lock->owns_lock() == true);
+    const std::thread::id tid = std::this_thread::get_id();
 
-    // Pick one job that still has work left
-    ParallelJob* job = job_list;
-    while (job && job->HaveWork() == false)
+    // Validate the cached index, another pool with fewer slots may have been created at the same address
+    if (slot_cache.thread_pool == this && slot_cache.index < slot_count &&
+        slots[slot_cache.index].owner.load(std::memory_order_relaxed) == tid)
     {
-        job = job->next;
+        return slot_cache.index;
     }
 
-    if (job)
+    int32 first_external = slot_count - external_slot_count;
+    for (int32 i = first_external; i < slot_count; ++i)
     {
-        // Execute work for this job
-        job->active_workers++;
-        job->RunStep(lock);
-
-        // Detach from this job
-        BulbitAssert(lock->owns_lock() == false);
-        lock->lock();
-        job->active_workers--;
-
-        // If the job is completed,
-        // we must signal condition variable for the thread that initially add the work.
-        // That initial thread may be waiting on the condition variable for other threads to finish their work on the job.
-        if (job->Finished())
+        if (slots[i].owner.load(std::memory_order_acquire) == tid)
         {
-            job_list_condition.notify_all();
+            slot_cache = SlotCache{ this, i };
+            return i;
         }
     }
-    else
+
+    return -1;
+}
+
+int32 ThreadPool::GetSlotIndex()
+{
+    int32 index = FindSlotIndex();
+    if (index >= 0)
+    {
+        return index;
+    }
+
+    static thread_local ExternalSlotGuard guard;
+
+    // Claim a free external deque, it is kept until the thread exits
+    const std::thread::id tid = std::this_thread::get_id();
+    for (int32 i = slot_count - external_slot_count; i < slot_count; ++i)
     {
-        // Wait for new work to arrive or the job to finish
-        job_list_condition.wait(*lock);
+        std::thread::id expected;
+        if (slots[i].owner.compare_exchange_strong(expected, tid))
+        {
+            guard.claims.emplace_back(slots, i);
+            slot_cache = SlotCache{ this, i };
+            return i;
+        }
     }
+
+    return -1;
 }
 
-bool ThreadPool::WorkOrReturn()
+ParallelJob* ThreadPool::Steal(int32 thief)
 {
-    // Return false if we do nothing
+    // Start at a random victim so that the thieves spread over the deques
+    static thread_local uint32 state = uint32(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
 
-    std::unique_lock<std::mutex> lock(mutex);
+    int32 start = int32(state % uint32(slot_count));
 
-    ParallelJob* job = job_list;
-    while (job && job->HaveWork() == false)
+    // Stealing from the own node first keeps the data a job touches in the local memory
+    int32 thief_node = thief >= 0 ? slots[thief].node : slots[0].node;
+    for (int32 pass = numa_aware ? 0 : 1; pass < 2; ++pass)
     {
-        job = job->next;
+        for (int32 i = 0; i < slot_count; ++i)
+        {
+            int32 victim = (start + i) % slot_count;
+            if (victim == thief || (pass == 0 && slots[victim].node != thief_node))
+            {
+                continue;
+            }
+
+            if (ParallelJob* job = slots[victim].deque.Steal())
+            {
+                return job;
+            }
+        }
     }
 
-    if (job == nullptr)
+    return nullptr;
+}
+
+bool ThreadPool::HasWork() const
+{
+    for (int32 i = 0; i < slot_count; ++i)
     {
-        return false;
+        if (!slots[i].deque.IsEmpty())
+        {
+            return true;
+        }
     }
 
-    job->active_workers++;
-    job->RunStep(&lock);
+    return false;
+}
 
-    BulbitAssert(lock.owns_lock() == false);
-    lock.lock();
-    job->active_workers--;
+bool ThreadPool::Submit(ParallelJob* job, int32 count)
+{
+    int32 index = GetSlotIndex();
+    if (index < 0)
+    {
+        return false;
+    }
 
-    if (job->Finished())
+    job->thread_pool = this;
+    for (int32 i = 0; i < count; ++i)
     {
-        job_list_condition.notify_all();
+        slots[index].deque.Push(job);
     }
 
+    Notify();
+
     return true;
 }
 
-std::unique_lock<std::mutex> ThreadPool::AddJob(ParallelJob* job)
+bool ThreadPool::RunPendingJob()
 {
-    job->thread_pool = this;
+    int32 index = GetSlotIndex();
 
-    std::unique_lock<std::mutex> lock(mutex);
-
-    // Link job to head of list
+    ParallelJob* job = nullptr;
+    if (index >= 0)
     {
-        if (job_list)
-        {
-            job_list->prev = job;
-        }
+        job = slots[index].deque.Pop();
+    }
 
-        job->next = job_list;
-        job_list = job;
+    if (!job)
+    {
+        job = Steal(index);
     }
 
-    // Notify to all workers
-    job_list_condition.notify_all();
+    if (!job)
+    {
+        return false;
+    }
 
-    return lock;
+    job->Run();
+    return true;
 }
 
-void ThreadPool::RemoveJob(ParallelJob* job)
+void ThreadPool::Park(const std::function<bool(void)>& done)
 {
-    // The lock must be held before calling this function
-    if (job->prev)
+    // New work often arrives right away, look for it a few more times before sleeping
+    for (int32 i = 0; i < park_spin_count; ++i)
     {
-        job->prev->next = job->next;
+        if (done() || HasWork())
+        {
+            return;
+        }
+
+        std::this_thread::yield();
     }
-    else
+
+    // Notify bumps the epoch after publishing, so either the checks below see the change or the wait returns
+    uint32 e = epoch.load();
+    sleeping.fetch_add(1);
+
+    if (!done() && !HasWork())
     {
-        job_list = job->next;
+        epoch.wait(e);
     }
 
-    if (job->next)
+    sleeping.fetch_sub(1);
+}
+
+void ThreadPool::Notify()
+{
+    epoch.fetch_add(1);
+
+    if (sleeping.load() > 0)
     {
-        job->next->prev = job->prev;
+        epoch.notify_all();
     }
 }
 
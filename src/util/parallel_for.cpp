@@ -3,50 +3,128 @@
 namespace bulbit
 {
 
-void ParallelForLoop::RunStep(std::unique_lock<std::mutex>* lock)
+void ParallelForLoopBase::Execute(ThreadPool* thread_pool)
 {
-    int32 index_begin = next_index;
-    int32 index_end = std::min(index_begin + chunk_size, end_index);
-    next_index = index_end;
+    int32 chunk_count = int32((end_index - next_index.load() + chunk_size - 1) / chunk_size);
 
-    // Remove job from list if all work has been started
-    if (HaveWork() == false)
+    // Submit the loop once for every other thread that can help
+    int32 helper_count = std::min(chunk_count, thread_pool->WorkerCount()) - 1;
+    if (helper_count > 0)
     {
-        thread_pool->RemoveJob(this);
+        pending.store(helper_count + 1);
+        if (!thread_pool->Submit(this, helper_count))
+        {
+            // No deque for this thread, run the whole loop here
+            pending.store(1);
+        }
     }
 
-    // Release lock and execute loop iterations in [begin, end)
-    lock->unlock();
-    func(index_begin, index_end);
+    // Current thread also work on the job
+    Run();
+
+    // Run other jobs until the helpers have finished their chunks
+    // Unstolen submissions of this loop are at the bottom of the own deque and return right away
+    while (!Finished())
+    {
+        if (!thread_pool->RunPendingJob())
+        {
+            thread_pool->Park([this]() { return Finished(); });
+        }
+    }
 }
 
-void ParallelFor(int32 begin, int32 end, std::function<void(int32, int32)> func, ThreadPool* thread_pool)
+void ParallelForLoopBase::Retire()
 {
-    if (begin == end)
+    ThreadPool* pool = thread_pool;
+    if (pending.fetch_sub(1) == 1 && pool)
     {
-        return;
+        pool->Notify();
     }
+}
+
+std::vector<AABB2i> GetParallelFor2DTiles(const Point2i& extents, int32 max_tile_size, int32 worker_count)
+{
+    // Smaller tiles cost more per pixel, shrink them only until every thread has enough to balance out
+    constexpr int32 min_tiles_per_worker = 16;
+    constexpr int32 min_tile_size = 4;
+
+    auto get_tile_counts = [&](int32 tile_size) {
+        return Point2i((extents.x + tile_size - 1) / tile_size, (extents.y + tile_size - 1) / tile_size);
+    };
 
-    if (!thread_pool)
+    int32 tile_size = std::max(max_tile_size, 1);
+    while (tile_size > min_tile_size)
     {
-        func(begin, end);
-        return;
+        Point2i counts = get_tile_counts(tile_size);
+        if (int64(counts.x) * counts.y >= int64(min_tiles_per_worker) * worker_count)
+        {
+            break;
+        }
+
+        tile_size = std::max((tile_size + 1) / 2, min_tile_size);
     }
 
-    // Compute chunk size for parallel loop
-    const int32 balance = 8;
-    int32 chunk_size = std::max<int32>(1, (end - begin) / (balance * int32(thread_pool->WorkerCount())));
+    Point2i tile_counts = get_tile_counts(tile_size);
+    uint32 grid_size = std::bit_ceil(uint32(std::max(tile_counts.x, tile_counts.y)));
 
-    // It's safe to allocate loop on the stack
-    // Because this ParallelFor() call does not return until all work for the loop is done.
-    ParallelForLoop loop(begin, end, chunk_size, std::move(func));
-    std::unique_lock<std::mutex> lock = thread_pool->AddJob(&loop);
+    struct Entry
+    {
+        uint32 key;
+        Point2i tile;
+    };
 
-    // Current thread also work on the job
-    while (!loop.Finished())
+    std::vector<Entry> entries;
+    entries.reserve(size_t(tile_counts.x) * tile_counts.y);
+    for (int32 y = 0; y < tile_counts.y; ++y)
     {
-        thread_pool->WorkOrWait(&lock);
+        for (int32 x = 0; x < tile_counts.x; ++x)
+        {
+            entries.push_back(Entry{ EncodeHilbert2(uint32(x), uint32(y), grid_size), Point2i(x, y) });
+        }
     }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+    auto get_bounds = [&](Point2i tile) {
+        Point2i min(tile.x * tile_size, tile.y * tile_size);
+        Point2i max(std::min(min.x + tile_size, extents.x), std::min(min.y + tile_size, extents.y));
+        return AABB2i(min, max);
+    };
+
+    // One tile per thread at the end is split, so the threads finish within a quarter tile of each other
+    int32 split_count = worker_count > 1 ? std::min(worker_count, int32(entries.size())) : 0;
+    int32 whole_count = int32(entries.size()) - split_count;
+
+    std::vector<AABB2i> tiles;
+    tiles.reserve(whole_count + 4 * split_count);
+    for (int32 i = 0; i < whole_count; ++i)
+    {
+        tiles.push_back(get_bounds(entries[i].tile));
+    }
+
+    for (int32 i = whole_count; i < int32(entries.size()); ++i)
+    {
+        AABB2i bounds = get_bounds(entries[i].tile);
+        Point2i mid = (bounds.min + bounds.max) / 2;
+
+        const AABB2i quadrants[4] = {
+            AABB2i(bounds.min, mid),
+            AABB2i(Point2i(mid.x, bounds.min.y), Point2i(bounds.max.x, mid.y)),
+            AABB2i(mid, bounds.max),
+            AABB2i(Point2i(bounds.min.x, mid.y), Point2i(mid.x, bounds.max.y)),
+        };
+
+        for (const AABB2i& quadrant : quadrants)
+        {
+            // Edge tiles may be too thin to split
+            if (quadrant.min.x < quadrant.max.x && quadrant.min.y < quadrant.max.y)
+            {
+                tiles.push_back(quadrant);
+            }
+        }
+    }
+
+    return tiles;
 }
 
 } // namespace bulbit